@@ -0,0 +1,74 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef ATOMIC_USTRING_H
+#define ATOMIC_USTRING_H
+
+#include "ustring.h"
+
+#ifdef USTRING_USE_THREADS
+
+#include <atomic>
+
+#ifndef USTRING_HAZARD_SLOTS
+#define USTRING_HAZARD_SLOTS			64//max number of load() calls that run at the same moment
+#endif
+
+/* Cell that holds immutable string, which can be read by many threads without locks while other
+ * threads replace it. Versions are allocated with malloc, because dalloc heaps can't be accessed
+ * from several threads. Readers get a snapshot, it keeps its version alive until destroyed. Old
+ * version is freed when the last snapshot of it is destroyed. */
+class atomic_ustring
+{
+public:
+	struct version_t;
+
+	class snapshot
+	{
+	private:
+		version_t *ver;
+
+	public:
+		snapshot();
+		explicit snapshot(version_t *ver_ptr);
+		snapshot(const snapshot &snap);
+		~snapshot();
+		snapshot& operator = (const snapshot &snap);
+
+		const char* c_str() const;
+		const char* data() const;
+		ustr_size_t size() const;
+		bool empty() const;
+	};
+
+	atomic_ustring();
+	~atomic_ustring();
+	atomic_ustring(const atomic_ustring &str) = delete;
+	atomic_ustring& operator = (const atomic_ustring &str) = delete;
+
+	snapshot load() const;
+	bool try_load(snapshot &snap) const;//doesn't wait if all hazard slots are busy
+	bool store(const char *str);
+	bool store(const char *str, ustr_size_t str_len);
+	bool store(ustring &str);
+
+private:
+	std::atomic<version_t*> current;
+};
+
+#endif // USTRING_USE_THREADS
+
+#endif // ATOMIC_USTRING_H
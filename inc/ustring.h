@@ -17,25 +17,64 @@
 #ifndef USTRING_H
 #define USTRING_H
 
+#include <string.h>
+#include <iterator>
 #include "uvector.h"
 
 #define USTRING_VERSION			"1.2.0"
 
 #define MIN_STRING_RESERVE		5
 
+/* Type of string sizes and positions, it can be redefined in dalloc_conf.h or with compiler
+ * flags, for example uint16_t on small MCUs. Anyway string size is limited by uvector size type */
+#ifndef USTRING_SIZE_TYPE
+#define USTRING_SIZE_TYPE		uint32_t
+#endif
+
+typedef USTRING_SIZE_TYPE ustr_size_t;
+
+/* Codecs use vector kernels if compiler targets SSE2/SSSE3, "USTRING_NO_SIMD" leaves only scalar code */
+#if defined(__SSE2__) && !defined(USTRING_NO_SIMD)
+#define USTRING_USE_SSE2
+#endif
+#if defined(__SSSE3__) && !defined(USTRING_NO_SIMD)
+#define USTRING_USE_SSSE3
+#endif
+
+uint32_t ustring_hash(const char *str, ustr_size_t str_len);
+
+class ustring_view;
+
 class ustring
 {
 private:
+	/* Only uvector is stored, so sizeof(ustring) == sizeof(uvector<char>). Tag and subscriptions are
+	 * kept in registries keyed by object address (see ustring_tag.h, ustring_pressure.h, ustring_idle.h).
+	 * Size, capacity and heap stay in uvector, it has no API to keep them in the memory block */
 	uvector<char> ch_container;
 
+	void terminate();
+	bool place(ustr_size_t new_str_size);
+	void on_capacity_change(uint32_t old_capacity, uint32_t new_capacity, uint32_t charged_capacity);
+	bool reserve_container(uint32_t new_capacity, bool placed);
+	bool ensure_capacity(ustr_size_t new_str_size);
+
 public:
+	typedef char value_type;
+	typedef char* iterator;
+	typedef const char* const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+	static const ustr_size_t npos = (ustr_size_t)-1;
+
     ustring();
 #ifdef USE_SINGLE_HEAP_MEMORY
-    ustring(uint32_t _size);
+    ustring(ustr_size_t _size);
     ustring(const char *str);
 #else
     ustring(heap_t *_alloc_mem_ptr);
-    ustring(uint32_t _size, heap_t *_alloc_mem_ptr);
+    ustring(ustr_size_t _size, heap_t *_alloc_mem_ptr);
     ustring(const char *str, heap_t *_alloc_mem_ptr);
     void assign_mem_pointer(heap_t *mem_ptr);
 #endif
@@ -44,38 +83,96 @@ public:
 	~ustring();
 	ustring& operator = (const ustring &string);
 
-	char& at(uint32_t i);
-	char& operator[](uint32_t i);
+	char& at(ustr_size_t i);
+	char& operator[](ustr_size_t i);
 	char& front();
 	char& back();
-	char* data() const;
+	char* data() const;//null terminated string data, or NULL if string has no memory yet, it never writes
 	const char* c_str();
 	bool empty();
-	uint32_t size() const;
-	uint32_t length() const;
-	bool reserve(uint32_t new_string_size);
-	uint32_t capacity();
+	ustr_size_t size() const;
+	ustr_size_t length() const;
+	bool reserve(ustr_size_t new_string_size);
+	ustr_size_t max_size() const;
+	ustr_size_t capacity();
 	bool shrink_to_fit();
 	void clear();
 	bool push_back(char item);
 	bool pop_back();
 	bool append(const char *str);
-	bool append(char *str, uint32_t str_len);
-	bool append(const char *str, uint32_t str_len);
-	bool append(ustring str);
+	bool append(char *str, ustr_size_t str_len);
+	bool append(const char *str, ustr_size_t str_len);
+	bool append(const ustring &str);
 	bool append(char ch);
+	char* append_buffer(ustr_size_t len);//receive data here, foreign dalloc blocks can't be adopted (see README)
+	bool append_format(const char *fmt, ...);
 	bool operator+=(const char *str);
-	bool operator+=(ustring str);
+	bool operator+=(const ustring &str);
 	bool operator+=(char ch);
-	bool resize(uint32_t new_str_size);
-	bool resize(uint32_t new_str_size, char value);
+	bool resize(ustr_size_t new_str_size);
+	bool resize(ustr_size_t new_str_size, char value);
 	ustring operator + (ustring &str);
 	ustring operator + (const char *str);
 	bool assign(const char *str);
-	bool assign(char *str, uint32_t str_len);
-	bool assign(ustring str);
-	bool assign(const char *str, uint32_t str_len);
+	bool assign(char *str, ustr_size_t str_len);
+	bool assign(const ustring &str);
+	bool assign(const char *str, ustr_size_t str_len);
 	heap_t* get_mem_pointer() const;
+	ustr_size_t find(const char *str, ustr_size_t pos = 0) const;
+	ustr_size_t find(char ch, ustr_size_t pos = 0) const;
+	ustr_size_t count(char ch) const;
+	uint32_t hash() const;
+	int32_t compare(const char *str) const;
+	int32_t compare(const char *str, ustr_size_t str_len) const;
+	void transform(char (*fn)(char));
+	void to_lower();
+	bool subscribe_memory_pressure();
+	void unsubscribe_memory_pressure();
+	bool set_idle_headroom(ustr_size_t headroom);
+	bool set_tag(uint8_t new_tag);
+	uint8_t get_tag() const;
+	bool append_base64(const void *src, ustr_size_t src_len, bool url_safe = false);
+	bool decode_base64(ustring_view src, bool url_safe = false);
+	bool append_hex(const void *src, ustr_size_t src_len, bool upper = false);
+	bool decode_hex(ustring_view src);
+	bool append_hexdump(const void *src, ustr_size_t src_len, uint32_t offset = 0);
+	bool append_json_escaped(ustring_view src);
+	bool append_json_unescaped(ustring_view src);
+
+	iterator begin();
+	iterator end();
+	const_iterator begin() const;
+	const_iterator end() const;
+	const_iterator cbegin() const;
+	const_iterator cend() const;
+	reverse_iterator rbegin();
+	reverse_iterator rend();
+	const_reverse_iterator rbegin() const;
+	const_reverse_iterator rend() const;
+	const_reverse_iterator crbegin() const;
+	const_reverse_iterator crend() const;
+};
+
+/* Non owning reference to characters. If it points to ustring data, it is valid only until
+ * the next allocation in the heap of that string, because dalloc may move the block */
+class ustring_view
+{
+private:
+	const char *ptr;
+	ustr_size_t len;
+
+public:
+	ustring_view() : ptr(""), len(0) {}
+	ustring_view(const char *str) : ptr(str), len(strlen(str)) {}
+	ustring_view(const char *str, ustr_size_t str_len) : ptr(str), len(str_len) {}
+	ustring_view(const ustring &str) : ptr(str.data()), len(str.size()) {}
+
+	const char* data() const { return ptr; }
+	ustr_size_t size() const { return len; }
+	bool empty() const { return len == 0; }
+	char operator[](ustr_size_t i) const { return ptr[i]; }
+	const char* begin() const { return ptr; }
+	const char* end() const { return ptr + len; }
 };
 
 #endif // USTRING_H
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_BASE64_H
+#define USTRING_BASE64_H
+
+#include "ustring.h"
+
+/* Base64 codec used by ustring::append_base64() and ustring::decode_base64(). Standard alphabet
+ * output is padded with '=', URL-safe alphabet ('-' and '_') output is not padded, decoder accepts
+ * both forms. If compiler targets SSSE3, 12 bytes are encoded (16 symbols decoded) per step. */
+
+ustr_size_t ustring_base64_encoded_size(ustr_size_t src_len, bool url_safe);
+void ustring_base64_encode(char *dst, const uint8_t *src, ustr_size_t src_len, bool url_safe);
+
+/* Returns exact size of decoded data or ustring::npos if length of src is not valid */
+ustr_size_t ustring_base64_decoded_size(const char *src, ustr_size_t src_len);
+/* dst should have ustring_base64_decoded_size() bytes, returns false on invalid symbol */
+bool ustring_base64_decode(uint8_t *dst, const char *src, ustr_size_t src_len, bool url_safe);
+
+#endif // USTRING_BASE64_H
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_BATCH_H
+#define USTRING_BATCH_H
+
+#include "ustring.h"
+
+#ifndef USTRING_PREFETCH_DISTANCE
+#define USTRING_PREFETCH_DISTANCE		4//how many strings ahead data is prefetched
+#endif
+
+/* Batch functions process a column of strings (plain array or uvector) and prefetch
+ * the data of upcoming strings, so cache misses on string buffers overlap with work.
+ * Output arrays should have at least strings_num elements. */
+void hash_all(const ustring *strings, uint32_t strings_num, uint32_t *hashes);
+void compare_all_to(const ustring *strings, uint32_t strings_num, const char *key, int32_t *results);
+void find_in_all(const ustring *strings, uint32_t strings_num, const char *pattern, ustr_size_t *positions);
+uint64_t total_size(const ustring *strings, uint32_t strings_num);
+
+/* recycle_all() makes all strings empty but keeps their memory, so the next batch of strings can be
+ * assigned to the same objects without allocations. release_all() frees memory of all strings and
+ * returns amount of released bytes */
+void recycle_all(ustring *strings, uint32_t strings_num);
+uint32_t release_all(ustring *strings, uint32_t strings_num);
+
+void hash_all(const uvector<ustring> &strings, uint32_t *hashes);
+void compare_all_to(const uvector<ustring> &strings, const char *key, int32_t *results);
+void find_in_all(const uvector<ustring> &strings, const char *pattern, ustr_size_t *positions);
+uint64_t total_size(const uvector<ustring> &strings);
+void recycle_all(uvector<ustring> &strings);
+uint32_t release_all(uvector<ustring> &strings);
+
+#endif // USTRING_BATCH_H
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_BINLOG_H
+#define USTRING_BINLOG_H
+
+#include "ustring.h"
+#include "ustring_format.h"
+
+/* Binary log: device stores only format id and raw arguments, text is produced later on host by
+ * the same formatting engine. Format strings are kept in a table shared by device and host:
+ *
+ *   const char *log_formats[] = {"boot, reason %u\n", "sensor %s: %d.%02u\n"};
+ *   ustring_binlog_write(log_buf, LOG_SENSOR, "t1", whole, frac);//device
+ *   ustring_binlog_decode_all(data, len, log_formats, 2, text);//host
+ *
+ * Record is [format id][arguments number][arguments], integers are stored as varints, strings are copied,
+ * doubles are stored as is, so device and host should have the same byte order. */
+
+inline ustring_fmt_arg_t ustring_binlog_arg(int val){ ustring_fmt_arg_t arg; arg.type = USTRING_ARG_INT; arg.val.i = val; return arg; }
+inline ustring_fmt_arg_t ustring_binlog_arg(long val){ ustring_fmt_arg_t arg; arg.type = USTRING_ARG_INT; arg.val.i = val; return arg; }
+inline ustring_fmt_arg_t ustring_binlog_arg(long long val){ ustring_fmt_arg_t arg; arg.type = USTRING_ARG_INT; arg.val.i = val; return arg; }
+inline ustring_fmt_arg_t ustring_binlog_arg(unsigned int val){ ustring_fmt_arg_t arg; arg.type = USTRING_ARG_UINT; arg.val.u = val; return arg; }
+inline ustring_fmt_arg_t ustring_binlog_arg(unsigned long val){ ustring_fmt_arg_t arg; arg.type = USTRING_ARG_UINT; arg.val.u = val; return arg; }
+inline ustring_fmt_arg_t ustring_binlog_arg(unsigned long long val){ ustring_fmt_arg_t arg; arg.type = USTRING_ARG_UINT; arg.val.u = val; return arg; }
+inline ustring_fmt_arg_t ustring_binlog_arg(double val){ ustring_fmt_arg_t arg; arg.type = USTRING_ARG_DOUBLE; arg.val.d = val; return arg; }
+inline ustring_fmt_arg_t ustring_binlog_arg(const void *val){ ustring_fmt_arg_t arg; arg.type = USTRING_ARG_PTR; arg.val.p = val; return arg; }
+inline ustring_fmt_arg_t ustring_binlog_arg(const char *val){ ustring_fmt_arg_t arg; arg.type = USTRING_ARG_STR; arg.len = ustring::npos; arg.val.s = val; return arg; }
+inline ustring_fmt_arg_t ustring_binlog_arg(const ustring &val){ ustring_fmt_arg_t arg; arg.type = USTRING_ARG_STR; arg.len = val.size(); arg.val.s = val.data(); return arg; }
+
+/* Appends one record to out, memory is reserved once for the whole record. String arguments
+ * should not be strings from the heap of out, allocation may move them */
+bool ustring_binlog_write_args(ustring &out, uint32_t fmt_id, const ustring_fmt_arg_t *args, uint32_t args_num);
+
+template<typename... Args>
+bool ustring_binlog_write(ustring &out, uint32_t fmt_id, const Args&... args){
+	static_assert(sizeof...(Args) <= USTRING_FORMAT_MAX_ARGS, "Too many arguments");
+	ustring_fmt_arg_t fmt_args[sizeof...(Args) + 1] = {ustring_binlog_arg(args)...};
+	return ustring_binlog_write_args(out, fmt_id, fmt_args, sizeof...(Args));
+}
+
+/* Decodes record starting at *pos and appends text to out, *pos is moved to the next record.
+ * Returns false if record is broken or its format id is unknown. data should not point to memory
+ * of strings from the heap of out (copy it or keep log in another heap), allocation may move it */
+bool ustring_binlog_decode(const uint8_t *data, ustr_size_t len, ustr_size_t *pos, const char *const *formats, uint32_t formats_num, ustring &out);
+/* Decodes all records, returns number of decoded records */
+uint32_t ustring_binlog_decode_all(const uint8_t *data, ustr_size_t len, const char *const *formats, uint32_t formats_num, ustring &out);
+
+#endif // USTRING_BINLOG_H
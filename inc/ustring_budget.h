@@ -0,0 +1,39 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_BUDGET_H
+#define USTRING_BUDGET_H
+
+#include "ustring.h"
+
+#ifndef USTRING_MAX_BUDGET_DOMAINS
+#define USTRING_MAX_BUDGET_DOMAINS		8
+#endif
+
+/* Budget domain of a string is its tag (see ustring::set_tag()), strings with tags that are not less
+ * than USTRING_MAX_BUDGET_DOMAINS are not accounted. Usage is a sum of capacities of domain strings.
+ * If growth doesn't fit to domain quota, string tries to grow without spare space, and if it
+ * doesn't fit too, growth fails. Quota 0 means unlimited domain. */
+bool ustring_budget_set_quota(uint8_t domain, uint32_t quota);
+uint32_t ustring_budget_get_quota(uint8_t domain);
+uint32_t ustring_budget_get_usage(uint8_t domain);
+
+bool ustring_budget_allows(uint8_t domain, uint32_t old_bytes, uint32_t new_bytes);
+/* Charges growth only if it fits to quota, check and charge are atomic */
+bool ustring_budget_try_charge(uint8_t domain, uint32_t old_bytes, uint32_t new_bytes);
+void ustring_budget_charge(uint8_t domain, uint32_t old_bytes, uint32_t new_bytes);
+
+#endif // USTRING_BUDGET_H
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_EXECUTOR_H
+#define USTRING_EXECUTOR_H
+
+#include "ustring.h"
+
+#ifdef USTRING_USE_THREADS
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef void (*ustring_task_fn_t)(void *arg);
+typedef void (*ustring_for_fn_t)(uint32_t ind, void *ctx);
+
+/* Small thread pool for string processing. Each worker has its own task deque: it takes its own tasks
+ * from the back and steals tasks of other workers from the front when it has nothing to do.
+ * In multi-heap mode each worker can get its own heap, so strings created by tasks don't share heaps
+ * between threads, use ustring_executor::current_heap() or ustring_worker_heap_policy for them. */
+class ustring_executor
+{
+private:
+	struct task_t{
+		ustring_task_fn_t fn;
+		void *arg;
+	};
+
+	struct worker_t{
+		std::mutex lock;
+		std::deque<task_t> tasks;
+		std::thread thread;
+		heap_t *heap;
+	};
+
+	std::vector<worker_t*> workers;
+	std::atomic<uint32_t> queued;//tasks in deques
+	std::atomic<uint32_t> pending;//submitted tasks that are not finished
+	std::atomic<uint32_t> next_worker;
+	bool stopping;
+	std::mutex idle_lock;
+	std::condition_variable idle_cv;
+	std::mutex done_lock;
+	std::condition_variable done_cv;
+
+	void worker_loop(uint32_t ind);
+	bool take_task(int32_t ind, task_t *task);
+	void run_task(task_t *task);
+	void push_task(task_t task);
+
+public:
+	ustring_executor();
+	~ustring_executor();
+	ustring_executor(const ustring_executor &executor) = delete;
+	ustring_executor& operator = (const ustring_executor &executor) = delete;
+
+	bool start(uint32_t workers_num, heap_t **heaps = NULL);//heaps is array of workers_num heaps
+	void stop();
+	uint32_t workers_num() const;
+
+	void submit(ustring_task_fn_t fn, void *arg);
+	void wait();//waits for all submitted tasks, shouldn't be called from tasks
+
+	/* Calls fn for each index from 0 to count - 1 on workers and calling thread, returns when
+	 * all calls are finished, can be called from tasks */
+	void parallel_for(uint32_t count, ustring_for_fn_t fn, void *ctx);
+
+	static heap_t* current_heap();//heap of current worker, NULL outside of workers
+	static int32_t current_worker();//index of current worker, -1 outside of workers
+};
+
+#ifndef USE_SINGLE_HEAP_MEMORY
+heap_t* ustring_worker_heap_policy(ustr_size_t size, uint8_t tag, heap_t *current);//see ustring_placement.h
+#endif
+
+#endif // USTRING_USE_THREADS
+
+#endif // USTRING_EXECUTOR_H
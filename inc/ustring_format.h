@@ -0,0 +1,63 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_FORMAT_H
+#define USTRING_FORMAT_H
+
+#include <stdarg.h>
+#include "ustring.h"
+
+#ifndef USTRING_FORMAT_MAX_ARGS
+#define USTRING_FORMAT_MAX_ARGS			16
+#endif
+
+/* Formatting engine of ustring, it works with array of arguments instead of va_list, so arguments
+ * can be stored and formatted later (see ustring_binlog.h). Supported conversions are
+ * %d %i %u %x %X %o %c %s %p %f %F %e %E %g %G %% with flags "-+ 0#", width, precision ("*" too)
+ * and length modifiers hh h l ll z j t. Floats are printed exactly like printf does, it takes
+ * about 1.2KB of stack. Format can't use more than USTRING_FORMAT_MAX_ARGS arguments. */
+typedef enum{
+	USTRING_ARG_INT = 0,
+	USTRING_ARG_UINT,
+	USTRING_ARG_DOUBLE,
+	USTRING_ARG_STR,
+	USTRING_ARG_PTR
+} ustring_arg_type_t;
+
+typedef struct{
+	uint8_t type;
+	ustr_size_t len;//length of USTRING_ARG_STR string, ustring::npos if it's null terminated
+	union{
+		int64_t i;
+		uint64_t u;
+		double d;
+		const char *s;
+		const void *p;
+	} val;
+} ustring_fmt_arg_t;
+
+/* Functions work like snprintf: output is truncated to out_size - 1 symbols and null terminated,
+ * return value is full length of formatted string. ustring::npos is returned if format needs more
+ * arguments than given, or result doesn't fit to ustr_size_t */
+ustr_size_t ustring_format_args(char *out, ustr_size_t out_size, const char *fmt, const ustring_fmt_arg_t *args, uint32_t args_num);
+ustr_size_t ustring_vformat(char *out, ustr_size_t out_size, const char *fmt, va_list va);
+ustr_size_t ustring_format(char *out, ustr_size_t out_size, const char *fmt, ...);
+
+/* Reads arguments described by fmt from va_list, returns number of arguments. At most max_args
+ * are read, formatting with the rest fails */
+uint32_t ustring_collect_args(const char *fmt, va_list va, ustring_fmt_arg_t *args, uint32_t max_args);
+
+#endif // USTRING_FORMAT_H
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_HEX_H
+#define USTRING_HEX_H
+
+#include "ustring.h"
+
+#define USTRING_HEXDUMP_LINE_BYTES		16
+#define USTRING_HEXDUMP_LINE_SIZE		79//"00000010  xx xx xx xx xx xx xx xx  xx xx xx xx xx xx xx xx  |................|\n"
+
+/* Hex codec used by ustring::append_hex(), ustring::decode_hex() and ustring::append_hexdump().
+ * If compiler targets SSSE3, nibbles are translated with shuffle lookup 16 bytes per step. */
+
+void ustring_hex_encode(char *dst, const uint8_t *src, ustr_size_t src_len, bool upper);
+/* src_len should be even, dst should have src_len / 2 bytes, returns false on not hex symbol */
+bool ustring_hex_decode(uint8_t *dst, const char *src, ustr_size_t src_len);
+
+/* Lines have the same layout as "hexdump -C" output, offset is added to printed addresses */
+ustr_size_t ustring_hexdump_size(ustr_size_t src_len);
+void ustring_hexdump(char *dst, const uint8_t *src, ustr_size_t src_len, uint32_t offset);
+
+#endif // USTRING_HEX_H
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_IDLE_H
+#define USTRING_IDLE_H
+
+#include "ustring.h"
+
+#ifndef USTRING_MAX_IDLE_STRINGS
+#define USTRING_MAX_IDLE_STRINGS		16//how many strings can be served by idle scheduler
+#endif
+
+/* dalloc defragments heap inside of allocation calls, so growth of string in time critical code
+ * can take a long time. Strings registered with ustring::set_idle_headroom() get their spare space
+ * restored by ustring_idle_step(), which should be called from idle loop or low priority task.
+ * So allocations and defragmentation happen in idle time, and appends in hot path fit in
+ * already reserved memory. Registered strings must not be moved in memory.
+ * Memory pressure relief (see ustring_pressure.h) can shrink registered strings that are subscribed
+ * to it, idle step grows them back only if the heap has free memory, it never relieves pressure itself,
+ * so the two don't take memory from each other in a loop. */
+typedef uint32_t (*ustring_time_fn_t)(void);
+
+bool ustring_idle_register(ustring *str, ustr_size_t headroom);
+void ustring_idle_unregister(ustring *str);
+uint32_t ustring_idle_strings_num();
+
+/* Processes registered strings one by one until "budget" time is spent (measured with "now",
+ * for example HAL_GetTick), if "now" is NULL only one string is processed.
+ * Returns number of strings that were grown. With USTRING_USE_THREADS registry is protected by
+ * mutex, but heaps are not, so step should be called by the thread that owns heaps of registered strings */
+uint32_t ustring_idle_step(ustring_time_fn_t now, uint32_t budget);
+
+#endif // USTRING_IDLE_H
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_INTERN_H
+#define USTRING_INTERN_H
+
+#include "ustring.h"
+
+#if defined(USTRING_USE_THREADS) && !defined(USE_SINGLE_HEAP_MEMORY)
+
+#include <shared_mutex>
+
+#ifndef USTRING_INTERN_SHARDS
+#define USTRING_INTERN_SHARDS			16//should be power of 2, not more than 256
+#endif
+
+#define USTRING_INTERN_INVALID_ID		0xFFFFFFFFUL
+
+/* Concurrent table of unique strings, each unique string gets id. Table is split into shards by
+ * string hash, each shard has its own lock and its own heap, so threads that work with different
+ * shards don't contend. Lookups in the same shard run in parallel, inserts lock the shard.
+ * Lookups can't be lock-free, because inserts may move shard strings during defragmentation. */
+class ustring_intern_table
+{
+private:
+	struct shard_t{
+		std::shared_mutex lock;
+		uvector<ustring> strings;
+		uvector<uint32_t> hashes;
+		uvector<uint32_t> slots;//open addressing index, string index + 1, 0 means empty slot
+	};
+
+	shard_t shards[USTRING_INTERN_SHARDS];
+
+	static uint32_t find_in_shard(shard_t *shard, const char *str, ustr_size_t str_len, uint32_t hash);
+	static bool grow_slots(shard_t *shard);
+
+public:
+	ustring_intern_table();
+	bool init(heap_t **heaps);//array of USTRING_INTERN_SHARDS heaps
+	ustring_intern_table(const ustring_intern_table &table) = delete;
+	ustring_intern_table& operator = (const ustring_intern_table &table) = delete;
+
+	uint32_t intern(const char *str);
+	uint32_t intern(const char *str, ustr_size_t str_len);
+	uint32_t find(const char *str);
+	uint32_t find(const char *str, ustr_size_t str_len);
+	bool get(uint32_t id, ustring &str);//copies string to str, str should not be in a shard heap
+	uint32_t size();
+};
+
+#endif // USTRING_USE_THREADS && !USE_SINGLE_HEAP_MEMORY
+
+#endif // USTRING_INTERN_H
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_JSON_H
+#define USTRING_JSON_H
+
+#include "ustring.h"
+
+/* JSON string escaping used by ustring::append_json_escaped() and ustring::append_json_unescaped().
+ * Quotes are not added. If compiler targets SSE2, symbols which need escaping are searched 16 per step
+ * and clean runs are copied as is. Not ASCII symbols are passed unchanged, so UTF-8 stays UTF-8. */
+
+uint64_t ustring_json_escaped_size(const char *src, ustr_size_t src_len);
+/* dst should have ustring_json_escaped_size() symbols */
+void ustring_json_escape(char *dst, const char *src, ustr_size_t src_len);
+
+/* Decodes escape sequences including \uXXXX and surrogate pairs (written as UTF-8), dst should have
+ * src_len symbols. Returns length of result or ustring::npos if escape sequence is broken */
+ustr_size_t ustring_json_unescape(char *dst, const char *src, ustr_size_t src_len);
+
+#endif // USTRING_JSON_H
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_JSON_READER_H
+#define USTRING_JSON_READER_H
+
+#include "ustring.h"
+
+typedef enum{
+	USTRING_JSON_INVALID = 0,
+	USTRING_JSON_OBJECT,
+	USTRING_JSON_ARRAY,
+	USTRING_JSON_STRING,
+	USTRING_JSON_NUMBER,
+	USTRING_JSON_TRUE,
+	USTRING_JSON_FALSE,
+	USTRING_JSON_NULL
+} ustring_json_type_t;
+
+class ustring_json_reader;
+
+/* Handle of a value inside of parsed document, it is not bound to memory, so it is cheap to copy.
+ * Objects and arrays are walked with first() and next(), for object members key() returns name of member */
+class ustring_json_value
+{
+	friend class ustring_json_reader;
+
+private:
+	ustring_json_reader *reader = NULL;
+	ustr_size_t pos = 0;//first symbol of the value
+	uint32_t ind = 0;//index entry of the first structural symbol at or after pos
+	uint32_t key_ind = UINT32_MAX;//index entry of opening quote of member name
+
+	uint32_t end_ind() const;
+
+public:
+	bool valid() const;
+	ustring_json_type_t type() const;
+
+	ustring_json_value first() const;
+	ustring_json_value next() const;
+	ustring_json_value get(ustring_view key) const;
+	ustring_json_value at(uint32_t n) const;
+	uint32_t count() const;
+
+	/* Views point to the source string, names and strings are returned without quotes and as is,
+	 * get_string() decodes escape sequences only if they are present */
+	ustring_view key() const;
+	ustring_view raw() const;
+	bool has_escapes() const;
+	bool get_string(ustring &out) const;
+	bool get_int(int64_t *val) const;
+	bool get_double(double *val) const;
+	bool get_bool(bool *val) const;
+	bool is_null() const;
+};
+
+/* On-demand JSON reader. parse() builds an index of structural symbols (brackets, colons, commas and
+ * quotes outside of strings) in one pass and checks their order, SSE2 is used to classify 16 symbols per step if it is
+ * available. Values are found by walking the index only when they are requested, nothing is copied.
+ * Index is allocated in the heap of the source string (or in the given heap) and accounted in the
+ * budget domain of the source string. Allocations in the heap of the source string may move it, so
+ * views are valid only until the next allocation in that heap, the reader itself reads source by
+ * reference and stays valid. */
+class ustring_json_reader
+{
+	friend class ustring_json_value;
+
+private:
+	const ustring &src;
+	uvector<ustr_size_t> index;
+	uint8_t domain;
+	uint32_t charged_bytes = 0;
+
+	bool grow_index();
+	bool push_entry(ustr_size_t pos);
+	bool build_index();
+	char symbol(ustr_size_t pos) const;
+	ustr_size_t entry(uint32_t ind);
+	ustr_size_t skip_spaces(ustr_size_t pos) const;
+	ustring_json_value value_at(ustr_size_t pos, uint32_t ind, uint32_t key_ind);
+
+public:
+	ustring_json_reader(const ustring &json);
+#ifndef USE_SINGLE_HEAP_MEMORY
+	ustring_json_reader(const ustring &json, heap_t *index_heap);
+#endif
+	~ustring_json_reader();
+	ustring_json_reader(const ustring_json_reader &reader) = delete;
+	ustring_json_reader& operator = (const ustring_json_reader &reader) = delete;
+
+	/* Returns false if quotes or brackets are not balanced, if members, commas or colons are misplaced,
+	 * if nesting is deeper than 1024 levels or if there is no memory for index */
+	bool parse();
+	ustring_json_value root();
+	uint32_t index_size() const;
+};
+
+#endif // USTRING_JSON_READER_H
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_PARALLEL_H
+#define USTRING_PARALLEL_H
+
+#include "ustring.h"
+
+#ifdef USTRING_USE_THREADS
+
+#ifndef USTRING_PARALLEL_MIN_CHUNK
+#define USTRING_PARALLEL_MIN_CHUNK		(256UL * 1024UL)//smaller strings are processed in one chunk
+#endif
+
+class ustring_executor;
+
+/* All functions split string data into chunks, which are processed by "threads" new threads
+ * (0 means std::thread::hardware_concurrency()) or by workers of executor (see ustring_executor.h).
+ * Workers take chunks dynamically, so a worker that finished its chunk early takes the next one
+ * instead of waiting. Heap that holds the string must not be modified while these functions are running. */
+ustr_size_t parallel_find(const ustring &str, const char *pattern, uint32_t threads = 0);
+ustr_size_t parallel_count(const ustring &str, char ch, uint32_t threads = 0);
+void parallel_transform(ustring &str, char (*fn)(char), uint32_t threads = 0);
+void parallel_to_lower(ustring &str, uint32_t threads = 0);
+
+ustr_size_t parallel_find(const ustring &str, const char *pattern, ustring_executor &executor);
+ustr_size_t parallel_count(const ustring &str, char ch, ustring_executor &executor);
+void parallel_transform(ustring &str, char (*fn)(char), ustring_executor &executor);
+void parallel_to_lower(ustring &str, ustring_executor &executor);
+
+#endif // USTRING_USE_THREADS
+
+#endif // USTRING_PARALLEL_H
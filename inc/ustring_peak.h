@@ -0,0 +1,47 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_PEAK_H
+#define USTRING_PEAK_H
+
+#include "ustring.h"
+
+#ifdef USTRING_TRACK_PEAK
+
+#ifndef USTRING_PEAK_BLOCK_OVERHEAD
+#define USTRING_PEAK_BLOCK_OVERHEAD		4//alignment losses per block, should match dalloc settings
+#endif
+
+/* Instrumentation mode, define USTRING_TRACK_PEAK to record memory usage of all strings, run your
+ * workload and then get recommended heap size. Memory moved by growth is counted twice, because
+ * old and new blocks exist at the same time while data is copied. */
+typedef struct{
+	uint32_t live_bytes;
+	uint32_t live_blocks;
+	uint32_t peak_bytes;
+	uint32_t peak_blocks;
+	uint32_t reallocations;//each reallocation leaves free gap in the heap until defragmentation
+} ustring_peak_stats_t;
+
+void ustring_peak_record(uint32_t old_capacity, uint32_t new_capacity);
+void ustring_peak_reset();
+void ustring_peak_get_stats(ustring_peak_stats_t *stats);
+uint32_t ustring_peak_recommended_heap_size(uint32_t headroom_percent);//(peak bytes + overhead of peak blocks) plus headroom, limited by UINT32_MAX
+void ustring_peak_print_report(uint32_t headroom_percent);
+
+#endif // USTRING_TRACK_PEAK
+
+#endif // USTRING_PEAK_H
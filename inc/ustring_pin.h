@@ -0,0 +1,62 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_PIN_H
+#define USTRING_PIN_H
+
+#include "ustring.h"
+
+#ifndef USTRING_MAX_PINNED_HEAPS
+#define USTRING_MAX_PINNED_HEAPS		4//how many heaps can allow pinning
+#endif
+
+/* dalloc moves blocks inside of both allocation and free calls, so pin freezes the whole heap: while
+ * at least one string in the heap is pinned, ustring methods that allocate or free memory in this
+ * heap (reserve, growth, shrink_to_fit, release_all) return false, and data pointers of all strings
+ * in the heap stay valid. Destructors can't fail, so strings of pinned heap should not be destroyed,
+ * and memory of the heap should not be allocated or freed bypassing ustring, until pins are released.
+ * Because pin affects all strings of the heap, heap should allow pinning explicitly, usually it's
+ * a dedicated heap for DMA buffers. Pin of a string from other heap is rejected, pinned() is false.
+ * append(), assign() and operator+= return false and keep the old value if memory is needed. Copy
+ * constructor, operator= and operator+ can't report failure, their result stays empty, so strings of
+ * pinned heap should be passed by reference and copied with assign(). */
+class ustring_pin
+{
+private:
+	heap_t *heap;
+	char *ptr;
+	ustr_size_t len;
+	uint32_t bytes;
+	bool active;
+
+public:
+	ustring_pin(ustring &str);
+	~ustring_pin();
+	ustring_pin(const ustring_pin &pin) = delete;
+	ustring_pin& operator = (const ustring_pin &pin) = delete;
+
+	bool pinned() const;
+	char* data() const;
+	ustr_size_t size() const;
+};
+
+bool ustring_heap_allow_pinning(heap_t *heap);
+bool ustring_heap_disallow_pinning(heap_t *heap);//fails while heap has pins
+bool ustring_heap_is_pinned(heap_t *heap);
+uint32_t ustring_pins_num(heap_t *heap);
+uint32_t ustring_pinned_bytes(heap_t *heap);
+
+#endif // USTRING_PIN_H
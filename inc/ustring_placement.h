@@ -0,0 +1,70 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_PLACEMENT_H
+#define USTRING_PLACEMENT_H
+
+#include "ustring.h"
+
+#ifndef USE_SINGLE_HEAP_MEMORY
+
+#ifndef USTRING_MAX_SPILL_HEAPS
+#define USTRING_MAX_SPILL_HEAPS			4
+#endif
+
+/* Placement policy selects heap for a string that has no allocated memory yet (new string, or string
+ * created by operator+), it gets required string size, string tag (see ustring::set_tag()) and heap
+ * that is assigned to the string now (can be NULL). Policy should return NULL to keep current heap.
+ * Only strings without heap are placed, so heap given explicitly (constructor with heap or
+ * assign_mem_pointer()) is kept, copies get the heap of the source string. Settings are guarded by
+ * a lock with USTRING_USE_THREADS, arrays passed to setters should stay valid while they are set. */
+typedef heap_t* (*ustring_placement_fn_t)(ustr_size_t size, uint8_t tag, heap_t *current);
+
+void ustring_set_placement_policy(ustring_placement_fn_t policy);
+heap_t* ustring_place(ustr_size_t size, uint8_t tag, heap_t *current);
+
+/* Size classes policy, classes should be sorted by max_size, strings bigger than
+ * max_size of the last class are placed to the heap of the last class */
+typedef struct{
+	ustr_size_t max_size;
+	heap_t *heap;
+} ustring_size_class_t;
+
+void ustring_set_size_classes(const ustring_size_class_t *classes, uint32_t classes_num);
+heap_t* ustring_size_class_policy(ustr_size_t size, uint8_t tag, heap_t *current);
+
+/* Tag policy, strings with tags that are not in the list stay in current heap */
+typedef struct{
+	uint8_t tag;
+	heap_t *heap;
+} ustring_tag_heap_t;
+
+void ustring_set_tag_heaps(const ustring_tag_heap_t *tag_heaps, uint32_t tag_heaps_num);
+heap_t* ustring_tag_policy(ustr_size_t size, uint8_t tag, heap_t *current);
+
+/* Fill level policy, string is placed to the heap with the most free memory. It reads offset and
+ * total_size of heap_t, so heaps in the list shouldn't be used by other threads meanwhile */
+void ustring_set_fill_heaps(heap_t * const *heaps, uint32_t heaps_num);
+heap_t* ustring_fill_level_policy(ustr_size_t size, uint8_t tag, heap_t *current);
+
+/* If string that got its heap from placement policy can't get memory in primary heap, it's moved to
+ * secondary heap. Heap given explicitly or taken from another string is never changed */
+bool ustring_set_spill_heap(heap_t *primary, heap_t *secondary);
+heap_t* ustring_get_spill_heap(heap_t *primary);
+
+#endif // USE_SINGLE_HEAP_MEMORY
+
+#endif // USTRING_PLACEMENT_H
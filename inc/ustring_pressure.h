@@ -0,0 +1,47 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_PRESSURE_H
+#define USTRING_PRESSURE_H
+
+#include "ustring.h"
+
+#ifndef USTRING_MAX_PRESSURE_SUBSCRIBERS
+#define USTRING_MAX_PRESSURE_SUBSCRIBERS	16//how many strings can be subscribed to low memory events
+#endif
+
+#ifndef USTRING_MAX_PRESSURE_CALLBACKS
+#define USTRING_MAX_PRESSURE_CALLBACKS		4
+#endif
+
+/* When ustring can't allocate memory, it releases spare memory of subscribed strings in the same
+ * heap (see ustring::subscribe_memory_pressure()), calls registered callbacks and retries allocation.
+ * Subscribed strings must not be moved in memory, so don't subscribe strings stored in uvector. */
+typedef void (*ustring_pressure_cb_t)(heap_t *heap);
+
+bool ustring_pressure_add_callback(ustring_pressure_cb_t cb);
+void ustring_pressure_remove_callback(ustring_pressure_cb_t cb);
+bool ustring_pressure_subscribe(ustring *str);
+void ustring_pressure_unsubscribe(ustring *str);
+uint32_t ustring_pressure_subscribers_num();
+uint32_t ustring_relieve_pressure(heap_t *heap, const ustring *requester);
+
+/* Suspends relief in calling thread for allocations that are optional, ustring_idle_step() uses it,
+ * so headroom taken back under pressure is restored only from free memory, without shrinking
+ * subscribed strings again (see ustring_idle.h) */
+void ustring_pressure_suspend(bool suspend);
+
+#endif // USTRING_PRESSURE_H
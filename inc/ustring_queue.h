@@ -0,0 +1,231 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_QUEUE_H
+#define USTRING_QUEUE_H
+
+#include "ustring.h"
+
+#ifdef USTRING_USE_THREADS
+
+#include <string.h>
+#include <atomic>
+
+#ifndef USTRING_CACHE_LINE_SIZE
+#define USTRING_CACHE_LINE_SIZE			64
+#endif
+
+/* Bounded lock-free queues for passing strings between threads. Heap block of ustring can't be passed
+ * to another thread, because dalloc heaps are not thread safe and block is tracked by address of its
+ * owner. So string data is copied once into preallocated queue slot, and consumer copies it into its
+ * own string in its own heap, so memory is always allocated and freed by the thread that owns the heap.
+ * SLOTS should be power of 2, strings longer than SLOT_SIZE are not accepted. If pop can't allocate
+ * memory for the item, it returns false and item stays in the queue. */
+
+template<uint32_t SLOTS, uint32_t SLOT_SIZE>
+class ustring_spsc_queue
+{
+	static_assert((SLOTS & (SLOTS - 1)) == 0, "SLOTS should be power of 2");
+
+private:
+	struct slot_t{
+		ustr_size_t len;
+		char data[SLOT_SIZE];
+	};
+
+	slot_t slots[SLOTS];
+	alignas(USTRING_CACHE_LINE_SIZE) std::atomic<uint32_t> head;//next slot to pop, written by consumer
+	alignas(USTRING_CACHE_LINE_SIZE) std::atomic<uint32_t> tail;//next slot to push, written by producer
+
+public:
+	ustring_spsc_queue(){
+		head.store(0);
+		tail.store(0);
+	}
+
+	bool push(const char *str, ustr_size_t str_len){
+		if(str_len > SLOT_SIZE){
+			return false;
+		}
+		uint32_t pos = tail.load(std::memory_order_relaxed);
+		if(pos - head.load(std::memory_order_acquire) >= SLOTS){
+			return false;//queue is full
+		}
+		slot_t *slot = &slots[pos & (SLOTS - 1)];
+		slot->len = str_len;
+		memcpy(slot->data, str, str_len);
+		tail.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool push(const ustring &str){
+		return push(str.data(), str.size());
+	}
+
+	bool pop(ustring &str){
+		uint32_t pos = head.load(std::memory_order_relaxed);
+		if(pos == tail.load(std::memory_order_acquire)){
+			return false;//queue is empty
+		}
+		slot_t *slot = &slots[pos & (SLOTS - 1)];
+		if(str.assign(slot->data, slot->len) != true){
+			return false;//item stays in the queue
+		}
+		head.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/* Batch functions publish all items with one index update, return number of processed items */
+	uint32_t push_batch(const ustring *strs, uint32_t strs_num){
+		uint32_t pos = tail.load(std::memory_order_relaxed);
+		uint32_t free_num = SLOTS - (pos - head.load(std::memory_order_acquire));
+		uint32_t num = 0;
+		while((num < strs_num) && (num < free_num) && (strs[num].size() <= SLOT_SIZE)){
+			slot_t *slot = &slots[(pos + num) & (SLOTS - 1)];
+			slot->len = strs[num].size();
+			memcpy(slot->data, strs[num].data(), slot->len);
+			num++;
+		}
+		tail.store(pos + num, std::memory_order_release);
+		return num;
+	}
+
+	uint32_t pop_batch(ustring *strs, uint32_t strs_num){
+		uint32_t pos = head.load(std::memory_order_relaxed);
+		uint32_t used_num = tail.load(std::memory_order_acquire) - pos;
+		uint32_t num = 0;
+		while((num < strs_num) && (num < used_num)){
+			slot_t *slot = &slots[(pos + num) & (SLOTS - 1)];
+			if(strs[num].assign(slot->data, slot->len) != true){
+				break;
+			}
+			num++;
+		}
+		head.store(pos + num, std::memory_order_release);
+		return num;
+	}
+};
+
+template<uint32_t SLOTS, uint32_t SLOT_SIZE>
+class ustring_mpmc_queue
+{
+	static_assert((SLOTS & (SLOTS - 1)) == 0, "SLOTS should be power of 2");
+
+private:
+	struct slot_t{
+		std::atomic<uint32_t> seq;//equals to position when slot is free, position + 1 when it has data
+		std::atomic<ustr_size_t> len;//consumers read it before claiming the slot
+		char data[SLOT_SIZE];
+	};
+
+	slot_t slots[SLOTS];
+	alignas(USTRING_CACHE_LINE_SIZE) std::atomic<uint32_t> enqueue_pos;
+	alignas(USTRING_CACHE_LINE_SIZE) std::atomic<uint32_t> dequeue_pos;
+
+public:
+	ustring_mpmc_queue(){
+		for(uint32_t i = 0; i < SLOTS; i++){
+			slots[i].seq.store(i, std::memory_order_relaxed);
+		}
+		enqueue_pos.store(0);
+		dequeue_pos.store(0);
+	}
+
+	bool push(const char *str, ustr_size_t str_len){
+		if(str_len > SLOT_SIZE){
+			return false;
+		}
+		uint32_t pos = enqueue_pos.load(std::memory_order_relaxed);
+		slot_t *slot;
+		while(1){
+			slot = &slots[pos & (SLOTS - 1)];
+			int32_t diff = (int32_t)(slot->seq.load(std::memory_order_acquire) - pos);
+			if(diff == 0){
+				if(enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+					break;
+				}
+			}
+			else if(diff < 0){
+				return false;//queue is full
+			}
+			else{
+				pos = enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+		slot->len.store(str_len, std::memory_order_relaxed);
+		memcpy(slot->data, str, str_len);
+		slot->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool push(const ustring &str){
+		return push(str.data(), str.size());
+	}
+
+	/* Claimed slot can't be returned to the queue, so memory for the item is reserved before claiming
+	 * and only if there is an item. If the slot is taken by another consumer meanwhile, its length may
+	 * be stale, but then claim fails and the next item is checked again */
+	bool pop(ustring &str){
+		uint32_t pos = dequeue_pos.load(std::memory_order_relaxed);
+		slot_t *slot;
+		while(1){
+			slot = &slots[pos & (SLOTS - 1)];
+			int32_t diff = (int32_t)(slot->seq.load(std::memory_order_acquire) - (pos + 1));
+			if(diff == 0){
+				ustr_size_t len = slot->len.load(std::memory_order_relaxed);
+				if(str.capacity() <= len){
+					if(str.reserve(len) != true){
+						return false;//item stays in the queue
+					}
+					pos = dequeue_pos.load(std::memory_order_relaxed);
+					continue;
+				}
+				if(dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+					break;
+				}
+			}
+			else if(diff < 0){
+				return false;//queue is empty
+			}
+			else{
+				pos = dequeue_pos.load(std::memory_order_relaxed);
+			}
+		}
+		str.assign(slot->data, slot->len.load(std::memory_order_relaxed));//fits to reserved memory
+		slot->seq.store(pos + SLOTS, std::memory_order_release);
+		return true;
+	}
+
+	uint32_t push_batch(const ustring *strs, uint32_t strs_num){
+		uint32_t num = 0;
+		while((num < strs_num) && push(strs[num])){
+			num++;
+		}
+		return num;
+	}
+
+	uint32_t pop_batch(ustring *strs, uint32_t strs_num){
+		uint32_t num = 0;
+		while((num < strs_num) && pop(strs[num])){
+			num++;
+		}
+		return num;
+	}
+};
+
+#endif // USTRING_USE_THREADS
+
+#endif // USTRING_QUEUE_H
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_RINGLOG_H
+#define USTRING_RINGLOG_H
+
+#include "ustring.h"
+
+#ifdef USTRING_USE_THREADS
+
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include "ustring_format.h"
+
+#ifndef USTRING_CACHE_LINE_SIZE
+#define USTRING_CACHE_LINE_SIZE			64
+#endif
+
+#ifndef USTRING_RINGLOG_MAX_RECORD
+#define USTRING_RINGLOG_MAX_RECORD		256//max length of one formatted record
+#endif
+
+#ifndef USTRING_RINGLOG_DRAIN_CHUNK
+#define USTRING_RINGLOG_DRAIN_CHUNK		4096//records are written to fd by chunks of this size
+#endif
+
+/* Fixed size log buffer for many writers and one reader. Writer formats record on its stack, reserves
+ * space in the ring with one CAS and copies record there, so logging never allocates memory and never
+ * waits for the reader: if there is no space, record is dropped and counted. Every record starts with
+ * header word, which is published last, so reader stops at the first record which is still being written.
+ * SIZE is size of ring in bytes, it should be power of 2. */
+
+template<uint32_t SIZE>
+class ustring_ringlog
+{
+	static_assert((SIZE & (SIZE - 1)) == 0, "SIZE should be power of 2");
+	static_assert(SIZE >= 2 * (USTRING_RINGLOG_MAX_RECORD + 4), "SIZE is too small for max record");
+	static_assert(SIZE <= (1UL << 30), "SIZE is too big");
+
+private:
+	enum{
+		HEADER_COMMITTED = 1UL << 31,
+		HEADER_PADDING = 1UL << 30,
+		HEADER_LEN_MASK = HEADER_PADDING - 1
+	};
+
+	std::atomic<uint32_t> words[SIZE / 4];
+	alignas(USTRING_CACHE_LINE_SIZE) std::atomic<uint32_t> head;//end of reserved space, written by writers
+	alignas(USTRING_CACHE_LINE_SIZE) std::atomic<uint32_t> tail;//start of unread records, written by reader
+	std::atomic<uint32_t> dropped_num;
+
+	static uint32_t record_size(uint32_t len){
+		return 4 + ((len + 3) & ~3UL);
+	}
+
+public:
+	ustring_ringlog(){
+		for(uint32_t i = 0; i < SIZE / 4; i++){
+			words[i].store(0, std::memory_order_relaxed);
+		}
+		head.store(0);
+		tail.store(0);
+		dropped_num.store(0);
+	}
+
+	bool write(const char *str, ustr_size_t str_len){
+		if(str_len > USTRING_RINGLOG_MAX_RECORD){
+			str_len = USTRING_RINGLOG_MAX_RECORD;
+		}
+		uint32_t need = record_size(str_len);
+		uint32_t pos = head.load(std::memory_order_relaxed);
+		uint32_t pad;
+		while(1){
+			uint32_t to_end = SIZE - (pos & (SIZE - 1));
+			pad = (need > to_end) ? to_end : 0;//record is not split, the rest of ring is skipped
+			if(pos + pad + need - tail.load(std::memory_order_acquire) > SIZE){
+				dropped_num.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			if(head.compare_exchange_weak(pos, pos + pad + need, std::memory_order_relaxed)){
+				break;
+			}
+		}
+
+		if(pad > 0){
+			words[(pos & (SIZE - 1)) / 4].store(HEADER_COMMITTED | HEADER_PADDING | pad, std::memory_order_release);
+			pos += pad;
+		}
+		uint32_t ind = (pos & (SIZE - 1)) / 4;
+		for(uint32_t i = 0; i < str_len; i += 4){
+			uint32_t word = 0;
+			memcpy(&word, str + i, (str_len - i < 4) ? str_len - i : 4);
+			words[ind + 1 + i / 4].store(word, std::memory_order_relaxed);
+		}
+		words[ind].store(HEADER_COMMITTED | str_len, std::memory_order_release);
+		return true;
+	}
+
+	bool write(const ustring &str){
+		return write(str.data(), str.size());
+	}
+
+	/* Record is truncated to USTRING_RINGLOG_MAX_RECORD symbols, new line is not added */
+	bool log(const char *fmt, ...){
+		ustring_fmt_arg_t args[USTRING_FORMAT_MAX_ARGS];
+		va_list va;
+		va_start(va, fmt);
+		uint32_t args_num = ustring_collect_args(fmt, va, args, USTRING_FORMAT_MAX_ARGS);
+		va_end(va);
+
+		char record[USTRING_RINGLOG_MAX_RECORD + 1];
+		ustr_size_t len = ustring_format_args(record, sizeof(record), fmt, args, args_num);
+		if(len == ustring::npos){
+			return false;
+		}
+		return write(record, (len < USTRING_RINGLOG_MAX_RECORD) ? len : USTRING_RINGLOG_MAX_RECORD);
+	}
+
+	/* Should be called by one reader thread, sink is called for every record,
+	 * returns number of read records */
+	template<typename Sink>
+	uint32_t drain(Sink sink){
+		uint32_t pos = tail.load(std::memory_order_relaxed);
+		uint32_t end = head.load(std::memory_order_acquire);
+		uint32_t num = 0;
+		uint32_t record[USTRING_RINGLOG_MAX_RECORD / 4 + 1];
+		while(pos != end){
+			uint32_t ind = (pos & (SIZE - 1)) / 4;
+			uint32_t header = words[ind].load(std::memory_order_acquire);
+			if((header & HEADER_COMMITTED) == 0){
+				break;//writer didn't finish the record yet
+			}
+			uint32_t len = header & HEADER_LEN_MASK;
+			uint32_t step = len;
+			if((header & HEADER_PADDING) == 0){
+				step = record_size(len);
+				for(uint32_t i = 0; i < (len + 3) / 4; i++){
+					record[i] = words[ind + 1 + i].load(std::memory_order_relaxed);
+				}
+			}
+			for(uint32_t i = 0; i < step / 4; i++){
+				words[ind + i].store(0, std::memory_order_relaxed);//stale data must not look like committed header
+			}
+			pos += step;
+			tail.store(pos, std::memory_order_release);
+			if((header & HEADER_PADDING) == 0){
+				sink((const char*)record, len);
+				num++;
+			}
+		}
+		return num;
+	}
+
+	/* Writes records to file descriptor as is, returns number of written records */
+	uint32_t drain(int fd){
+		char chunk[USTRING_RINGLOG_DRAIN_CHUNK];
+		uint32_t chunk_len = 0;
+		uint32_t num = drain([&](const char *str, uint32_t len){
+			if(chunk_len + len > sizeof(chunk)){
+				flush(fd, chunk, chunk_len);
+				chunk_len = 0;
+			}
+			memcpy(chunk + chunk_len, str, len);
+			chunk_len += len;
+		});
+		flush(fd, chunk, chunk_len);
+		return num;
+	}
+
+	uint32_t dropped(){
+		return dropped_num.load(std::memory_order_relaxed);
+	}
+
+private:
+	static void flush(int fd, const char *data, uint32_t len){
+		while(len > 0){
+			ssize_t res = ::write(fd, data, len);
+			if(res <= 0){
+				return;
+			}
+			data += res;
+			len -= res;
+		}
+	}
+};
+
+#endif // USTRING_USE_THREADS
+
+#endif // USTRING_RINGLOG_H
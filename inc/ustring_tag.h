@@ -0,0 +1,33 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef USTRING_TAG_H
+#define USTRING_TAG_H
+
+#include "ustring.h"
+
+#ifndef USTRING_MAX_TAGGED_STRINGS
+#define USTRING_MAX_TAGGED_STRINGS		64//how many strings can have not zero tag at the same time
+#endif
+
+/* ustring object holds only uvector, so tags are kept in a table keyed by string address. Strings with
+ * tag 0 don't use the table, and lookup is skipped at all while there are no tagged strings. Tagged
+ * strings must not be moved in memory, so don't tag strings stored in uvector. */
+bool ustring_tag_set(const ustring *str, uint8_t tag);//tag 0 removes string from the table
+uint8_t ustring_tag_get(const ustring *str);
+uint32_t ustring_tagged_strings_num();
+
+#endif // USTRING_TAG_H
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "atomic_ustring.h"
+
+#ifdef USTRING_USE_THREADS
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <thread>
+
+struct atomic_ustring::version_t{
+	std::atomic<uint32_t> refs;
+	ustr_size_t len;
+	char str[1];//null terminated string data
+};
+
+/* Hazard slots protect the moment between reading current version and taking reference to it,
+ * writer doesn't drop its reference while some reader has the version in its slot. Reader holds
+ * slot only inside of load(), so number of threads is not limited by number of slots */
+static std::atomic<atomic_ustring::version_t*> hazards[USTRING_HAZARD_SLOTS];
+static std::atomic<bool> hazards_used[USTRING_HAZARD_SLOTS];
+static thread_local uint32_t hazard_hint = 0;//threads start search from their last slot, so they rarely collide
+
+/* Returns -1 if all slots are busy */
+static int32_t take_hazard_slot(){
+	for(uint32_t i = 0; i < USTRING_HAZARD_SLOTS; i++){
+		uint32_t ind = (hazard_hint + i) % USTRING_HAZARD_SLOTS;
+		bool expected = false;
+		if(!hazards_used[ind].load(std::memory_order_relaxed) &&
+				hazards_used[ind].compare_exchange_strong(expected, true, std::memory_order_acquire)){
+			hazard_hint = ind;
+			return ind;
+		}
+	}
+	return -1;
+}
+
+static void release_hazard_slot(int32_t slot){
+	hazards[slot].store(NULL, std::memory_order_release);
+	hazards_used[slot].store(false, std::memory_order_release);
+}
+
+static atomic_ustring::version_t* new_version(const char *str, ustr_size_t str_len){
+	atomic_ustring::version_t *ver = (atomic_ustring::version_t*)malloc(sizeof(atomic_ustring::version_t) + str_len);
+	if(ver == NULL){
+		return NULL;
+	}
+	new (&ver->refs) std::atomic<uint32_t>(1);
+	ver->len = str_len;
+	if(str_len > 0){
+		memcpy(ver->str, str, str_len);
+	}
+	ver->str[str_len] = '\0';
+	return ver;
+}
+
+static void unref_version(atomic_ustring::version_t *ver){
+	if((ver != NULL) && (ver->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)){
+		free(ver);
+	}
+}
+
+static void retire_version(atomic_ustring::version_t *ver){
+	if(ver == NULL){
+		return;
+	}
+	for(uint32_t i = 0; i < USTRING_HAZARD_SLOTS; i++){
+		while(hazards[i].load(std::memory_order_seq_cst) == ver){
+			std::this_thread::yield();//reader is taking reference right now
+		}
+	}
+	unref_version(ver);
+}
+
+atomic_ustring::snapshot::snapshot(){
+	ver = NULL;
+}
+
+atomic_ustring::snapshot::snapshot(version_t *ver_ptr){
+	ver = ver_ptr;
+}
+
+atomic_ustring::snapshot::snapshot(const snapshot &snap){
+	ver = snap.ver;
+	if(ver != NULL){
+		ver->refs.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+atomic_ustring::snapshot::~snapshot(){
+	unref_version(ver);
+}
+
+atomic_ustring::snapshot& atomic_ustring::snapshot::operator = (const snapshot &snap){
+	if(&snap != this){
+		if(snap.ver != NULL){
+			snap.ver->refs.fetch_add(1, std::memory_order_relaxed);
+		}
+		unref_version(ver);
+		ver = snap.ver;
+	}
+	return *this;
+}
+
+const char* atomic_ustring::snapshot::c_str() const{
+	return (ver != NULL) ? ver->str : "";
+}
+
+const char* atomic_ustring::snapshot::data() const{
+	return c_str();
+}
+
+ustr_size_t atomic_ustring::snapshot::size() const{
+	return (ver != NULL) ? ver->len : 0;
+}
+
+bool atomic_ustring::snapshot::empty() const{
+	return size() == 0;
+}
+
+atomic_ustring::atomic_ustring(){
+	current.store(NULL);
+}
+
+atomic_ustring::~atomic_ustring(){
+	retire_version(current.exchange(NULL));
+}
+
+bool atomic_ustring::try_load(snapshot &snap) const{
+	int32_t slot = take_hazard_slot();
+	if(slot < 0){
+		return false;
+	}
+	/* Hazard store, re-check of current version and exchange in store() are seq_cst, so either writer
+	 * sees the hazard in retire_version(), or reader sees the new version and retries */
+	version_t *ver;
+	do{
+		ver = current.load(std::memory_order_acquire);
+		hazards[slot].store(ver, std::memory_order_seq_cst);
+	}while(ver != current.load(std::memory_order_seq_cst));
+
+	if(ver != NULL){
+		ver->refs.fetch_add(1, std::memory_order_relaxed);
+	}
+	release_hazard_slot(slot);
+	snap = snapshot(ver);
+	return true;
+}
+
+atomic_ustring::snapshot atomic_ustring::load() const{
+	snapshot snap;
+	while(try_load(snap) != true){
+		std::this_thread::yield();//all slots are taken by other load() calls right now, they are short
+	}
+	return snap;
+}
+
+bool atomic_ustring::store(const char *str){
+	return store(str, strlen(str));
+}
+
+bool atomic_ustring::store(const char *str, ustr_size_t str_len){
+	version_t *ver = new_version(str, str_len);
+	if(ver == NULL){
+		return false;
+	}
+	retire_version(current.exchange(ver, std::memory_order_seq_cst));
+	return true;
+}
+
+bool atomic_ustring::store(ustring &str){
+	return store(str.data(), str.size());
+}
+
+#endif // USTRING_USE_THREADS
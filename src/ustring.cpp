@@ -14,13 +14,27 @@
  *  limitations under the License.
  */
 
+#include <string.h>
 #include "ustring.h"
-
-char& ustring::at(uint32_t i){
+#include "ustring_pin.h"
+#include "ustring_pressure.h"
+#include "ustring_idle.h"
+#include "ustring_placement.h"
+#include "ustring_budget.h"
+#include "ustring_peak.h"
+#include "ustring_tag.h"
+#include "ustring_format.h"
+#include "ustring_base64.h"
+#include "ustring_hex.h"
+#include "ustring_json.h"
+
+static_assert(sizeof(ustring) == sizeof(uvector<char>), "ustring state is kept in registries, not in the object");
+
+char& ustring::at(ustr_size_t i){
 	return ch_container.at(i);
 }
 
-char& ustring::operator[](uint32_t i){
+char& ustring::operator[](ustr_size_t i){
 	return at(i);
 }
 
@@ -33,100 +47,378 @@ char& ustring::back(){
 }
 
 char* ustring::data() const{
-	return ch_container.data();
+	return ch_container.data();//doesn't write anything, so it's safe to call from concurrent readers
 }
 
 const char* ustring::c_str(){
-	return data();
+	if(ch_container.capacity() == 0){
+		return "";
+	}
+	terminate();//symbol after the last one could be overwritten through data() or iterators
+	return ch_container.data();
+}
+
+/* Mutators write null terminate symbol right after the last symbol, it is one store instead of
+ * removing and adding it back on every push_back(). Capacity always has space for it */
+void ustring::terminate(){
+	char *str = ch_container.data();
+	if(str != NULL){
+		str[ch_container.size()] = '\0';
+	}
 }
 
 bool ustring::empty(){
 	return ch_container.empty();
 }
 
-uint32_t ustring::size() const{
-	if(ch_container.size() > 0){
-		return ch_container.size() - 1;//size without null terminate symbol
-	}
-	return ch_container.size();
+ustr_size_t ustring::size() const{
+	return ch_container.size();//null terminate symbol is stored after the last symbol, see c_str()
 }
 
-uint32_t ustring::length() const{
+ustr_size_t ustring::length() const{
 	return size();
 }
 
-bool ustring::reserve(uint32_t new_string_size){
-	return ch_container.reserve(new_string_size + 1);//+ null terminate symbol
+bool ustring::reserve(ustr_size_t new_string_size){
+	if(ch_container.capacity() > new_string_size){
+		return true;
+	}
+	if(new_string_size > max_size()){
+		return false;
+	}
+	bool placed = place(new_string_size);
+	if(ustring_heap_is_pinned(get_mem_pointer())){
+		return false;//allocation may move pinned strings
+	}
+	return reserve_container(new_string_size + 1, placed);//+ null terminate symbol
+}
+
+/* npos is reserved, and capacity with null terminate symbol should fit to uint32_t of uvector */
+ustr_size_t ustring::max_size() const{
+	uint64_t max_len = ((uint64_t)npos < (uint64_t)UINT32_MAX) ? (uint64_t)npos : (uint64_t)UINT32_MAX;
+	return (ustr_size_t)(max_len - 1);
 }
 
-uint32_t ustring::capacity(){
+ustr_size_t ustring::capacity(){
 	return ch_container.capacity();
 }
 
 bool ustring::shrink_to_fit(){
-	return ch_container.shrink_to_fit();
+	if(ustring_heap_is_pinned(get_mem_pointer())){
+		return false;
+	}
+	uint32_t old_capacity = ch_container.capacity();
+	bool res;
+	if(ch_container.size() == 0){
+		res = ch_container.shrink_to_fit();
+	}
+	else{
+		/* Keep space for null terminate symbol */
+		if(ch_container.push_back('\0') != true){
+			return false;
+		}
+		res = ch_container.shrink_to_fit();
+		ch_container.pop_back();//null terminate symbol stays in memory
+	}
+	on_capacity_change(old_capacity, ch_container.capacity(), old_capacity);
+	return res;
 }
 
 void ustring::clear(){
 	ch_container.clear();
+	terminate();
 }
 
-bool ustring::push_back(char item){
-	if(ch_container.size() > 0){
-		if(ch_container.pop_back() != true){//remove null terminate symbol
-			return false;
+/* Returns true if heap is selected by placement policy now, only such strings can spill to another heap */
+bool ustring::place(ustr_size_t new_str_size){
+#ifndef USE_SINGLE_HEAP_MEMORY
+	if((ch_container.capacity() == 0) && (get_mem_pointer() == NULL)){//heap given by user is not changed
+		ch_container.assign_mem_pointer(ustring_place(new_str_size, get_tag(), NULL));
+		return get_mem_pointer() != NULL;
+	}
+#else
+	(void)new_str_size;
+#endif
+	return false;
+}
+
+/* charged_capacity is capacity that is already charged to budget domain, growth is charged before allocation */
+void ustring::on_capacity_change(uint32_t old_capacity, uint32_t new_capacity, uint32_t charged_capacity){
+	if(new_capacity != charged_capacity){
+		ustring_budget_charge(get_tag(), charged_capacity, new_capacity);
+	}
+#ifdef USTRING_TRACK_PEAK
+	if(new_capacity != old_capacity){
+		ustring_peak_record(old_capacity, new_capacity);
+	}
+#else
+	(void)old_capacity;
+#endif
+}
+
+bool ustring::reserve_container(uint32_t new_capacity, bool placed){
+	uint32_t old_capacity = ch_container.capacity();
+	uint32_t charged_capacity = (new_capacity > old_capacity) ? new_capacity : old_capacity;
+	if(ustring_budget_try_charge(get_tag(), old_capacity, charged_capacity) != true){
+		return false;//quota of budget domain is exceeded
+	}
+	bool res = ch_container.reserve(new_capacity);
+	if(res != true){
+		ustring_relieve_pressure(get_mem_pointer(), this);//callbacks may release memory too, so retry anyway
+		res = ch_container.reserve(new_capacity);
+	}
+#ifndef USE_SINGLE_HEAP_MEMORY
+	if(res != true){
+		heap_t *spill_heap = ustring_get_spill_heap(get_mem_pointer());
+		if(placed && (spill_heap != NULL) && (ch_container.capacity() == 0) && !ustring_heap_is_pinned(spill_heap)){
+			ch_container.assign_mem_pointer(spill_heap);
+			res = ch_container.reserve(new_capacity);
 		}
 	}
-	if(ch_container.push_back(item) != true){
+#else
+	(void)placed;
+#endif
+	terminate();//new block may not contain null terminate symbol
+	on_capacity_change(old_capacity, ch_container.capacity(), charged_capacity);
+	return res;
+}
+
+bool ustring::ensure_capacity(ustr_size_t new_str_size){
+	if(new_str_size > max_size()){
 		return false;
 	}
-	return ch_container.push_back(0);//add null terminate symbol
+	uint32_t needed = (uint32_t)new_str_size + 1;//+ null terminate symbol, max_size() guarantees it fits
+	uint32_t cap = ch_container.capacity();
+	if(cap >= needed){
+		return true;
+	}
+	bool placed = place(new_str_size);
+	if(ustring_heap_is_pinned(get_mem_pointer())){
+		return false;//allocation may move pinned strings
+	}
+	uint64_t grown_cap = (uint64_t)cap + cap / 2;//grow geometrically, so appending char by char is amortized
+	if(grown_cap > (uint64_t)max_size() + 1){
+		grown_cap = (uint64_t)max_size() + 1;
+	}
+	uint32_t new_cap = (uint32_t)grown_cap;
+	if(new_cap < needed){
+		new_cap = needed;
+	}
+	if(new_cap < MIN_STRING_RESERVE){
+		new_cap = MIN_STRING_RESERVE;
+	}
+	uint8_t tag = get_tag();
+	if(ustring_budget_try_charge(tag, cap, new_cap) == true){
+		if(ch_container.reserve(new_cap) == true){
+			terminate();//new block may not contain null terminate symbol
+			on_capacity_change(cap, ch_container.capacity(), new_cap);
+			return true;
+		}
+		ustring_budget_charge(tag, new_cap, cap);
+	}
+	return reserve_container(needed, placed);//not enough memory or quota for spare space, try exact size
 }
 
-bool ustring::pop_back(){
-	if(size() == 0){
+char* ustring::append_buffer(ustr_size_t len){
+	ustr_size_t old_size = size();
+	if(len > max_size() - old_size){
+		return NULL;//new size doesn't fit to ustr_size_t or uvector capacity
+	}
+	if(ensure_capacity(old_size + len) != true){
+		return NULL;
+	}
+	if(ch_container.resize(old_size + len, 0) != true){
+		return NULL;
+	}
+	terminate();
+	return ch_container.data() + old_size;
+}
+
+bool ustring::append_format(const char *fmt, ...){
+	ustring_fmt_arg_t args[USTRING_FORMAT_MAX_ARGS];
+	va_list va;
+	va_start(va, fmt);
+	uint32_t args_num = ustring_collect_args(fmt, va, args, USTRING_FORMAT_MAX_ARGS);
+	va_end(va);
+
+	ustr_size_t len = ustring_format_args(NULL, 0, fmt, args, args_num);
+	if(len == npos){
+		return false;
+	}
+	char *dst = append_buffer(len);
+	if(dst == NULL){
 		return false;
 	}
+	ustring_format_args(dst, len + 1, fmt, args, args_num);//terminator fits to reserved symbol
+	return true;
+}
 
-	if(ch_container.pop_back() != true){//remove null terminate symbol
+bool ustring::append_base64(const void *src, ustr_size_t src_len, bool url_safe){
+	if(src_len / 3 >= npos / 4 - 1){
+		return false;//encoded data doesn't fit to ustr_size_t
+	}
+	ustr_size_t len = ustring_base64_encoded_size(src_len, url_safe);
+	char *dst = append_buffer(len);
+	if(dst == NULL){
 		return false;
 	}
+	ustring_base64_encode(dst, (const uint8_t*)src, src_len, url_safe);
+	return true;
+}
 
-	if(ch_container.pop_back() != true){//remove last string symbol
+/* src should not point to memory of strings from the heap of this string, allocation may move it */
+bool ustring::decode_base64(ustring_view src, bool url_safe){
+	ustr_size_t len = ustring_base64_decoded_size(src.data(), src.size());
+	if(len == npos){
+		return false;
+	}
+	ustr_size_t old_size = size();
+	char *dst = append_buffer(len);
+	if(dst == NULL){
+		return false;
+	}
+	if(ustring_base64_decode((uint8_t*)dst, src.data(), src.size(), url_safe) != true){
+		resize(old_size);
 		return false;
 	}
+	return true;
+}
 
-	return ch_container.push_back(0);//add null terminate symbol
+bool ustring::append_hex(const void *src, ustr_size_t src_len, bool upper){
+	if(src_len >= npos / 2){
+		return false;
+	}
+	char *dst = append_buffer(src_len * 2);
+	if(dst == NULL){
+		return false;
+	}
+	ustring_hex_encode(dst, (const uint8_t*)src, src_len, upper);
+	return true;
 }
 
-bool ustring::append(const char *str){
-	uint32_t ind = 0;
-	if(str[ind] == '\0'){
+/* src should not point to memory of strings from the heap of this string, allocation may move it */
+bool ustring::decode_hex(ustring_view src){
+	if(src.size() % 2 != 0){
+		return false;
+	}
+	ustr_size_t old_size = size();
+	char *dst = append_buffer(src.size() / 2);
+	if(dst == NULL){
 		return false;
 	}
-	while(str[ind] != '\0'){
-		push_back(str[ind]);
-		ind++;
+	if(ustring_hex_decode((uint8_t*)dst, src.data(), src.size()) != true){
+		resize(old_size);
+		return false;
 	}
 	return true;
 }
 
-bool ustring::append(char *str, uint32_t str_len){
-	for(uint32_t i = 0; i < str_len; i++){
-		if(push_back(str[i]) != true){
-			return false;
-		}
+bool ustring::append_hexdump(const void *src, ustr_size_t src_len, uint32_t offset){
+	if(src_len / USTRING_HEXDUMP_LINE_BYTES >= npos / USTRING_HEXDUMP_LINE_SIZE - 1){
+		return false;
+	}
+	char *dst = append_buffer(ustring_hexdump_size(src_len));
+	if(dst == NULL){
+		return false;
 	}
+	ustring_hexdump(dst, (const uint8_t*)src, src_len, offset);
 	return true;
 }
 
-bool ustring::append(const char *str, uint32_t str_len){
+/* src should not point to memory of strings from the heap of this string, allocation may move it */
+bool ustring::append_json_escaped(ustring_view src){
+	uint64_t len = ustring_json_escaped_size(src.data(), src.size());
+	if(size() + len >= npos){
+		return false;
+	}
+	char *dst = append_buffer(len);
+	if(dst == NULL){
+		return false;
+	}
+	ustring_json_escape(dst, src.data(), src.size());
+	return true;
+}
+
+/* src should not point to memory of strings from the heap of this string, allocation may move it */
+bool ustring::append_json_unescaped(ustring_view src){
+	ustr_size_t old_size = size();
+	char *dst = append_buffer(src.size());//result is never longer than source
+	if(dst == NULL){
+		return false;
+	}
+	ustr_size_t len = ustring_json_unescape(dst, src.data(), src.size());
+	if(len == npos){
+		resize(old_size);
+		return false;
+	}
+	return resize(old_size + len);
+}
+
+bool ustring::push_back(char item){
+	if(size() >= max_size()){
+		return false;
+	}
+	if(ensure_capacity(size() + 1) != true){
+		return false;
+	}
+	if(ch_container.push_back(item) != true){
+		return false;
+	}
+	terminate();
+	return true;
+}
+
+bool ustring::pop_back(){
+	if(ch_container.pop_back() != true){
+		return false;
+	}
+	terminate();
+	return true;
+}
+
+bool ustring::append(const char *str){
+	if(str[0] == '\0'){
+		return false;
+	}
+	return append(str, strlen(str));
+}
+
+bool ustring::append(char *str, ustr_size_t str_len){
+	if(str_len == 0){
+		return true;
+	}
+	char *dst = append_buffer(str_len);
+	if(dst == NULL){
+		return false;
+	}
+	memcpy(dst, str, str_len);
+	return true;
+}
+
+bool ustring::append(const char *str, ustr_size_t str_len){
 	return append(const_cast<char*>(str), str_len);
 }
 
-bool ustring::append(ustring str){
-	uint32_t str_len = str.size();
-	return append(str.c_str(), str_len);
+/* str may live in the heap of this string (or be this string), allocation may move it,
+ * so its data is taken only after memory is reserved */
+bool ustring::append(const ustring &str){
+	ustr_size_t old_size = size();
+	ustr_size_t str_len = str.size();
+	if(str_len == 0){
+		return true;
+	}
+	if(str_len > max_size() - old_size){
+		return false;
+	}
+	if(ensure_capacity(old_size + str_len) != true){
+		return false;
+	}
+	char *dst = append_buffer(str_len);//memory is already reserved, so nothing moves
+	if(dst == NULL){
+		return false;
+	}
+	memcpy(dst, str.data(), str_len);
+	return true;
 }
 
 bool ustring::append(char ch){
@@ -137,7 +429,7 @@ bool ustring::operator+=(const char *str){
 	return append(str);
 }
 
-bool ustring::operator+=(ustring str){
+bool ustring::operator+=(const ustring &str){
 	return append(str);
 }
 
@@ -145,86 +437,238 @@ bool ustring::operator+=(char ch){
 	return append(ch);
 }
 
-bool ustring::resize(uint32_t new_str_size){
+bool ustring::resize(ustr_size_t new_str_size){
 	return resize(new_str_size, 0);
 }
 
-bool ustring::resize(uint32_t new_str_size, char value){
+bool ustring::resize(ustr_size_t new_str_size, char value){
 	if(size() == new_str_size){
 		return true;
 	}
-	if(size() > new_str_size){
-		for(uint32_t i = 0; i < size() - new_str_size; i++){
-			pop_back();
-		}
-		return true;
-	}
-
-	if(capacity() > new_str_size){
-		if(ch_container.resize(new_str_size + 1, value) != true){
-			return false;
-		}
-		ch_container.back() = '\0';
-		if(ch_container.pop_back() != true){
-			return false;
-		}
-		return true;
+	if(ensure_capacity(new_str_size) != true){
+		return false;
 	}
-	if(reserve(new_str_size) != true){
+	if(ch_container.resize(new_str_size, value) != true){
 		return false;
 	}
-	if(ch_container.resize(new_str_size + 1, value) != true){
+	terminate();
+	return true;
+}
+
+bool ustring::assign(const char *str){
+	if(str[0] == '\0'){
 		return false;
 	}
-	ch_container.back() = '\0';
-	if(ch_container.pop_back() != true){
+	return assign(str, strlen(str));
+}
+
+/* Memory is reserved before the old value is cleared, so if it fails (pinned heap, quota, no memory)
+ * the string keeps its old value */
+bool ustring::assign(char *str, ustr_size_t str_len){
+	if((str_len > 0) && (ensure_capacity(str_len) != true)){
 		return false;
 	}
+	clear();
+	return append(str, str_len);
+}
 
-	return true;
+bool ustring::assign(const char *str, ustr_size_t str_len){
+	return assign(const_cast<char*>(str), str_len);
 }
 
-bool ustring::assign(const char *str){
-	uint32_t ind = 0;
-	if(str[ind] == '\0'){
+bool ustring::assign(const ustring &str){
+	if(&str == this){
+		return true;
+	}
+	if((str.size() > 0) && (ensure_capacity(str.size()) != true)){
 		return false;
 	}
-	ch_container.clear();
-	while(str[ind] != '\0'){
-		if(push_back(str[ind]) != true){
-			return false;
+	clear();
+	return append(str);
+}
+
+heap_t* ustring::get_mem_pointer() const{
+    return ch_container.get_mem_pointer();
+}
+
+ustr_size_t ustring::find(const char *str, ustr_size_t pos) const{
+	ustr_size_t str_len = strlen(str);
+	ustr_size_t self_len = size();
+	if((pos > self_len) || (str_len > self_len - pos)){
+		return npos;
+	}
+	if(str_len == 0){
+		return pos;
+	}
+	const char *start = ch_container.data();
+	const char *last = start + self_len - str_len;//last position where match can begin
+	const char *cur = start + pos;
+	while(cur <= last){
+		cur = (const char*)memchr(cur, str[0], last - cur + 1);
+		if(cur == NULL){
+			return npos;
 		}
-		ind++;
+		if(memcmp(cur, str, str_len) == 0){
+			return cur - start;
+		}
+		cur++;
 	}
-	return true;
+	return npos;
 }
 
-bool ustring::assign(char *str, uint32_t str_len){
-	ch_container.clear();
-	for(uint32_t i = 0; i < str_len; i++){
-		if(push_back(str[i]) != true){
-			return false;
+ustr_size_t ustring::find(char ch, ustr_size_t pos) const{
+	if(pos >= size()){
+		return npos;
+	}
+	const char *res = (const char*)memchr(ch_container.data() + pos, ch, size() - pos);
+	if(res == NULL){
+		return npos;
+	}
+	return res - ch_container.data();
+}
+
+ustr_size_t ustring::count(char ch) const{
+	ustr_size_t res = 0;
+	const char *str = ch_container.data();
+	ustr_size_t str_len = size();
+	for(ustr_size_t i = 0; i < str_len; i++){
+		res += (str[i] == ch);
+	}
+	return res;
+}
+
+uint32_t ustring_hash(const char *str, ustr_size_t str_len){
+	uint32_t res = 2166136261UL;//FNV-1a
+	for(ustr_size_t i = 0; i < str_len; i++){
+		res ^= (uint8_t)str[i];
+		res *= 16777619UL;
+	}
+	return res;
+}
+
+uint32_t ustring::hash() const{
+	return ustring_hash(ch_container.data(), size());
+}
+
+int32_t ustring::compare(const char *str) const{
+	return compare(str, strlen(str));
+}
+
+int32_t ustring::compare(const char *str, ustr_size_t str_len) const{
+	ustr_size_t self_len = size();
+	ustr_size_t min_len = (self_len < str_len) ? self_len : str_len;
+	if(min_len > 0){
+		int res = memcmp(ch_container.data(), str, min_len);
+		if(res != 0){
+			return (res < 0) ? -1 : 1;
+		}
+	}
+	if(self_len == str_len){
+		return 0;
+	}
+	return (self_len < str_len) ? -1 : 1;
+}
+
+void ustring::transform(char (*fn)(char)){
+	char *str = ch_container.data();
+	ustr_size_t str_len = size();
+	for(ustr_size_t i = 0; i < str_len; i++){
+		str[i] = fn(str[i]);
+	}
+}
+
+void ustring::to_lower(){
+	char *str = ch_container.data();
+	ustr_size_t str_len = size();
+	for(ustr_size_t i = 0; i < str_len; i++){
+		if((str[i] >= 'A') && (str[i] <= 'Z')){
+			str[i] += 'a' - 'A';
 		}
 	}
+}
+
+/* Registrations are kept by registries (keyed by string address), ustring object doesn't store them */
+bool ustring::subscribe_memory_pressure(){
+	return ustring_pressure_subscribe(this);
+}
+
+void ustring::unsubscribe_memory_pressure(){
+	ustring_pressure_unsubscribe(this);
+}
+
+bool ustring::set_idle_headroom(ustr_size_t headroom){
+	if(headroom == 0){
+		ustring_idle_unregister(this);
+		return true;
+	}
+	return ustring_idle_register(this, headroom);
+}
+
+bool ustring::set_tag(uint8_t new_tag){
+	uint8_t old_tag = get_tag();
+	if(ustring_tag_set(this, new_tag) != true){
+		return false;//tag table is full
+	}
+	uint32_t cur_capacity = ch_container.capacity();
+	ustring_budget_charge(old_tag, cur_capacity, 0);
+	ustring_budget_charge(new_tag, 0, cur_capacity);
 	return true;
 }
 
-bool ustring::assign(const char *str, uint32_t str_len){
-	return assign(const_cast<char*>(str), str_len);
+uint8_t ustring::get_tag() const{
+	return ustring_tag_get(this);
 }
 
-bool ustring::assign(ustring str){
-	uint32_t str_len = str.size();
-	ch_container.clear();
-	return assign(str.c_str(), str_len);
+ustring::iterator ustring::begin(){
+	return ch_container.data();
 }
 
-heap_t* ustring::get_mem_pointer() const{
-    return ch_container.get_mem_pointer();
+ustring::iterator ustring::end(){
+	return ch_container.data() + size();
+}
+
+ustring::const_iterator ustring::begin() const{
+	return ch_container.data();
+}
+
+ustring::const_iterator ustring::end() const{
+	return ch_container.data() + size();
+}
+
+ustring::const_iterator ustring::cbegin() const{
+	return begin();
+}
+
+ustring::const_iterator ustring::cend() const{
+	return end();
+}
+
+ustring::reverse_iterator ustring::rbegin(){
+	return reverse_iterator(end());
+}
+
+ustring::reverse_iterator ustring::rend(){
+	return reverse_iterator(begin());
+}
+
+ustring::const_reverse_iterator ustring::rbegin() const{
+	return const_reverse_iterator(end());
+}
+
+ustring::const_reverse_iterator ustring::rend() const{
+	return const_reverse_iterator(begin());
+}
+
+ustring::const_reverse_iterator ustring::crbegin() const{
+	return rbegin();
+}
+
+ustring::const_reverse_iterator ustring::crend() const{
+	return rend();
 }
 
 #ifdef USE_SINGLE_HEAP_MEMORY
-ustring::ustring(uint32_t _size){
+ustring::ustring(ustr_size_t _size){
     resize(_size);
 }
 
@@ -234,48 +678,39 @@ ustring::ustring(const char *str){
 }
 
 ustring::ustring(const ustring &string){
-    for(uint32_t i = 0; i < string.size(); i++){
-        this->push_back(string.data()[i]);
-    }
+    this->set_tag(string.get_tag());
+    this->append(string);
 }
 
 ustring& ustring::operator = (const ustring &string){
     if(&string != this){
-        for(uint32_t i = 0; i < string.size(); i++){
-            this->push_back(string.data()[i]);
-        }
+        this->append(string);
     }
     return *this;
 }
 
 ustring ustring::operator + (ustring &str){
-    uint32_t self_str_len = this->size();
-    uint32_t new_str_len = str.size();
-    ustring new_string(self_str_len + new_str_len);
-    new_string.clear();
-
-    for(uint32_t i = 0; i < self_str_len; i++){
-        new_string.push_back(this->at(i));
-    }
-    for(uint32_t i = 0; i < new_str_len; i++){
-        new_string.push_back(str.at(i));
-    }
+    ustr_size_t self_str_len = this->size();
+    ustr_size_t new_str_len = str.size();
+    ustring new_string;
+    new_string.set_tag(get_tag());
+    new_string.reserve(self_str_len + new_str_len);
+
+    new_string.append(*this);
+    new_string.append(str);
     return new_string;
 }
 
 ustring ustring::operator + (const char *str){
-    uint32_t self_str_len = this->size();
-    uint32_t new_str_len = strlen(str);
+    ustr_size_t self_str_len = this->size();
+    ustr_size_t new_str_len = strlen(str);
 
-    ustring new_string(self_str_len + new_str_len);
-    new_string.clear();
+    ustring new_string;
+    new_string.set_tag(get_tag());
+    new_string.reserve(self_str_len + new_str_len);
 
-    for(uint32_t i = 0; i < self_str_len; i++){
-        new_string.push_back(this->at(i));
-    }
-    for(uint32_t i = 0; i < new_str_len; i++){
-        new_string.push_back(str[i]);
-    }
+    new_string.append(*this);
+    new_string.append(str, new_str_len);
     return new_string;
 }
 #else
@@ -283,65 +718,59 @@ void ustring::assign_mem_pointer(heap_t *mem_ptr){
     ch_container.assign_mem_pointer(mem_ptr);
 }
 
-ustring::ustring(uint32_t _size, heap_t *_alloc_mem_ptr){
-    ch_container.assign_mem_pointer(_alloc_mem_ptr);
+ustring::ustring(ustr_size_t _size, heap_t *_alloc_mem_ptr){
+    assign_mem_pointer(_alloc_mem_ptr);
     resize(_size);
 }
 
 ustring::ustring(heap_t *_alloc_mem_ptr){
-    ch_container.assign_mem_pointer(_alloc_mem_ptr);
+    assign_mem_pointer(_alloc_mem_ptr);
 }
 
 ustring::ustring(const char *str, heap_t *_alloc_mem_ptr){
-    ch_container.assign_mem_pointer(_alloc_mem_ptr);
+    assign_mem_pointer(_alloc_mem_ptr);
     assign(str);
 }
 
+/* Copy goes to the heap of the source string, it's placed by policy only if the source has no heap yet */
 ustring::ustring(const ustring &string){
-    this->assign_mem_pointer(string.get_mem_pointer());
-    for(uint32_t i = 0; i < string.size(); i++){
-        this->push_back(string.data()[i]);
-    }
+    this->ch_container.assign_mem_pointer(string.get_mem_pointer());
+    this->set_tag(string.get_tag());
+    this->append(string);
 }
 
 ustring& ustring::operator = (const ustring &string){
     if(&string != this){
-        this->assign_mem_pointer(string.get_mem_pointer());
-        for(uint32_t i = 0; i < string.size(); i++){
-            this->push_back(string.data()[i]);
-        }
+        this->ch_container.assign_mem_pointer(string.get_mem_pointer());
+        this->append(string);
     }
     return *this;
 }
 
 ustring ustring::operator + (ustring &str){
-    uint32_t self_str_len = this->size();
-    uint32_t new_str_len = str.size();
-    ustring new_string(self_str_len + new_str_len, this->ch_container.get_mem_pointer());
-    new_string.clear();
-
-    for(uint32_t i = 0; i < self_str_len; i++){
-        new_string.push_back(this->at(i));
-    }
-    for(uint32_t i = 0; i < new_str_len; i++){
-        new_string.push_back(str.at(i));
-    }
+    ustr_size_t self_str_len = this->size();
+    ustr_size_t new_str_len = str.size();
+    ustring new_string;
+    new_string.set_tag(get_tag());
+    new_string.ch_container.assign_mem_pointer(ustring_place(self_str_len + new_str_len, get_tag(), get_mem_pointer()));//result is placed by policy
+    new_string.reserve(self_str_len + new_str_len);
+
+    new_string.append(*this);
+    new_string.append(str);
     return new_string;
 }
 
 ustring ustring::operator + (const char *str){
-    uint32_t self_str_len = this->size();
-    uint32_t new_str_len = strlen(str);
+    ustr_size_t self_str_len = this->size();
+    ustr_size_t new_str_len = strlen(str);
 
-    ustring new_string(self_str_len + new_str_len, this->ch_container.get_mem_pointer());
-    new_string.clear();
+    ustring new_string;
+    new_string.set_tag(get_tag());
+    new_string.ch_container.assign_mem_pointer(ustring_place(self_str_len + new_str_len, get_tag(), get_mem_pointer()));//result is placed by policy
+    new_string.reserve(self_str_len + new_str_len);
 
-    for(uint32_t i = 0; i < self_str_len; i++){
-        new_string.push_back(this->at(i));
-    }
-    for(uint32_t i = 0; i < new_str_len; i++){
-        new_string.push_back(str[i]);
-    }
+    new_string.append(*this);
+    new_string.append(str, new_str_len);
     return new_string;
 }
 #endif
@@ -351,5 +780,8 @@ ustring::ustring(){
 }
 
 ustring::~ustring(){
-
+	unsubscribe_memory_pressure();
+	set_idle_headroom(0);
+	on_capacity_change(ch_container.capacity(), 0, ch_container.capacity());
+	ustring_tag_set(this, 0);
 }
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "ustring_base64.h"
+
+#ifdef USTRING_USE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+static const char std_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char url_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+#define INVALID_SEXTET					0xFF
+
+static inline uint8_t sextet(char ch, bool url_safe){
+	if((ch >= 'A') && (ch <= 'Z')){
+		return ch - 'A';
+	}
+	if((ch >= 'a') && (ch <= 'z')){
+		return ch - 'a' + 26;
+	}
+	if((ch >= '0') && (ch <= '9')){
+		return ch - '0' + 52;
+	}
+	if(ch == (url_safe ? '-' : '+')){
+		return 62;
+	}
+	if(ch == (url_safe ? '_' : '/')){
+		return 63;
+	}
+	return INVALID_SEXTET;
+}
+
+#ifdef USTRING_USE_SSSE3
+/* Encodes 12 bytes from the beginning of 16 loaded bytes to 16 symbols */
+static inline __m128i encode_block(__m128i in, bool url_safe){
+	/* Every 3 bytes are spread to 4 bytes and 6-bit indexes are moved to separate bytes by multiplications */
+	in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	__m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+	__m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+	__m128i indexes = _mm_or_si128(t0, t1);
+
+	/* Index range selects offset which is added to index: 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12 */
+	__m128i range = _mm_subs_epu8(indexes, _mm_set1_epi8(51));
+	range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indexes), _mm_set1_epi8(13)));
+	__m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, (url_safe ? '-' : '+') - 62, (url_safe ? '_' : '/') - 63, 'A', 0, 0);
+	return _mm_add_epi8(indexes, _mm_shuffle_epi8(offsets, range));
+}
+
+static inline __m128i in_range(__m128i in, char low, char high){
+	return _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8(low - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8(high + 1)));
+}
+
+/* Decodes 16 symbols to 12 bytes at the beginning of result, returns false if block has not alphabet symbols */
+static inline bool decode_block(__m128i in, bool url_safe, __m128i *out){
+	__m128i upper = in_range(in, 'A', 'Z');
+	__m128i lower = in_range(in, 'a', 'z');
+	__m128i digits = in_range(in, '0', '9');
+	__m128i plus = _mm_cmpeq_epi8(in, _mm_set1_epi8(url_safe ? '-' : '+'));
+	__m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8(url_safe ? '_' : '/'));
+	__m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digits, _mm_or_si128(plus, slash)));
+	if(_mm_movemask_epi8(valid) != 0xFFFF){
+		return false;
+	}
+
+	__m128i offsets = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+	offsets = _mm_or_si128(offsets, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+	offsets = _mm_or_si128(offsets, _mm_and_si128(digits, _mm_set1_epi8(52 - '0')));
+	offsets = _mm_or_si128(offsets, _mm_and_si128(plus, _mm_set1_epi8(62 - (url_safe ? '-' : '+'))));
+	offsets = _mm_or_si128(offsets, _mm_and_si128(slash, _mm_set1_epi8(63 - (url_safe ? '_' : '/'))));
+	__m128i sextets = _mm_add_epi8(in, offsets);
+
+	/* Join 4 sextets to 24 bits and reorder bytes */
+	__m128i pairs = _mm_maddubs_epi16(sextets, _mm_set1_epi32(0x01400140));
+	__m128i words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+	*out = _mm_shuffle_epi8(words, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+	return true;
+}
+#endif
+
+ustr_size_t ustring_base64_encoded_size(ustr_size_t src_len, bool url_safe){
+	if(url_safe){
+		return (src_len / 3) * 4 + ((src_len % 3 == 0) ? 0 : src_len % 3 + 1);
+	}
+	return ((src_len + 2) / 3) * 4;
+}
+
+void ustring_base64_encode(char *dst, const uint8_t *src, ustr_size_t src_len, bool url_safe){
+	const char *alphabet = url_safe ? url_alphabet : std_alphabet;
+	ustr_size_t i = 0;
+#ifdef USTRING_USE_SSSE3
+	for(; src_len - i >= 16; i += 12){//16 bytes are loaded, 12 of them are encoded
+		__m128i res = encode_block(_mm_loadu_si128((const __m128i*)(src + i)), url_safe);
+		_mm_storeu_si128((__m128i*)dst, res);
+		dst += 16;
+	}
+#endif
+	for(; src_len - i >= 3; i += 3){
+		uint32_t triple = ((uint32_t)src[i] << 16) | ((uint32_t)src[i + 1] << 8) | src[i + 2];
+		*dst++ = alphabet[(triple >> 18) & 0x3F];
+		*dst++ = alphabet[(triple >> 12) & 0x3F];
+		*dst++ = alphabet[(triple >> 6) & 0x3F];
+		*dst++ = alphabet[triple & 0x3F];
+	}
+	ustr_size_t rest = src_len - i;
+	if(rest > 0){
+		uint32_t triple = ((uint32_t)src[i] << 16) | ((rest > 1) ? ((uint32_t)src[i + 1] << 8) : 0);
+		*dst++ = alphabet[(triple >> 18) & 0x3F];
+		*dst++ = alphabet[(triple >> 12) & 0x3F];
+		if(rest > 1){
+			*dst++ = alphabet[(triple >> 6) & 0x3F];
+		}
+		if(!url_safe){
+			*dst++ = '=';
+			if(rest == 1){
+				*dst++ = '=';
+			}
+		}
+	}
+}
+
+static ustr_size_t strip_padding(const char *src, ustr_size_t src_len){
+	if((src_len > 0) && (src_len % 4 == 0)){
+		for(uint32_t i = 0; (i < 2) && (src[src_len - 1] == '='); i++){
+			src_len--;
+		}
+	}
+	return src_len;
+}
+
+ustr_size_t ustring_base64_decoded_size(const char *src, ustr_size_t src_len){
+	src_len = strip_padding(src, src_len);
+	if(src_len % 4 == 1){
+		return ustring::npos;
+	}
+	return (src_len / 4) * 3 + ((src_len % 4 == 0) ? 0 : src_len % 4 - 1);
+}
+
+bool ustring_base64_decode(uint8_t *dst, const char *src, ustr_size_t src_len, bool url_safe){
+	src_len = strip_padding(src, src_len);
+	if(src_len % 4 == 1){
+		return false;
+	}
+	ustr_size_t i = 0;
+#ifdef USTRING_USE_SSSE3
+	for(; src_len - i >= 24; i += 16){//16 bytes are stored, 12 of them are decoded, so dst should have space for 4 more bytes
+		__m128i res;
+		if(decode_block(_mm_loadu_si128((const __m128i*)(src + i)), url_safe, &res) != true){
+			return false;
+		}
+		_mm_storeu_si128((__m128i*)dst, res);
+		dst += 12;
+	}
+#endif
+	while(i < src_len){
+		uint32_t quad = 0;
+		ustr_size_t num = (src_len - i < 4) ? src_len - i : 4;
+		for(ustr_size_t j = 0; j < 4; j++){
+			uint8_t val = 0;
+			if(j < num){
+				val = sextet(src[i + j], url_safe);
+				if(val == INVALID_SEXTET){
+					return false;
+				}
+			}
+			quad = (quad << 6) | val;
+		}
+		for(ustr_size_t j = 0; j + 1 < num; j++){
+			*dst++ = (uint8_t)(quad >> (16 - j * 8));
+		}
+		i += num;
+	}
+	return true;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <string.h>
+#include "ustring_batch.h"
+
+#if defined(__GNUC__)
+#define USTRING_PREFETCH(addr)			__builtin_prefetch((addr), 0, 3)
+#else
+#define USTRING_PREFETCH(addr)
+#endif
+
+/* Strings objects are prefetched two distances ahead and their data one distance ahead,
+ * so data pointer is already in cache when string data is prefetched */
+static inline void prefetch_ahead(const ustring *strings, uint32_t strings_num, uint32_t i){
+	if(i + 2 * USTRING_PREFETCH_DISTANCE < strings_num){
+		USTRING_PREFETCH(&strings[i + 2 * USTRING_PREFETCH_DISTANCE]);
+	}
+	if(i + USTRING_PREFETCH_DISTANCE < strings_num){
+		USTRING_PREFETCH(strings[i + USTRING_PREFETCH_DISTANCE].data());
+	}
+}
+
+void hash_all(const ustring *strings, uint32_t strings_num, uint32_t *hashes){
+	for(uint32_t i = 0; i < strings_num; i++){
+		prefetch_ahead(strings, strings_num, i);
+		hashes[i] = strings[i].hash();
+	}
+}
+
+void compare_all_to(const ustring *strings, uint32_t strings_num, const char *key, int32_t *results){
+	ustr_size_t key_len = strlen(key);
+	for(uint32_t i = 0; i < strings_num; i++){
+		prefetch_ahead(strings, strings_num, i);
+		results[i] = strings[i].compare(key, key_len);
+	}
+}
+
+void find_in_all(const ustring *strings, uint32_t strings_num, const char *pattern, ustr_size_t *positions){
+	for(uint32_t i = 0; i < strings_num; i++){
+		prefetch_ahead(strings, strings_num, i);
+		positions[i] = strings[i].find(pattern);
+	}
+}
+
+uint64_t total_size(const ustring *strings, uint32_t strings_num){
+	uint64_t res = 0;//sum of many strings doesn't fit to uint32_t
+	for(uint32_t i = 0; i < strings_num; i++){
+		if(i + USTRING_PREFETCH_DISTANCE < strings_num){
+			USTRING_PREFETCH(&strings[i + USTRING_PREFETCH_DISTANCE]);//only objects are needed here
+		}
+		res += strings[i].size();
+	}
+	return res;
+}
+
+void recycle_all(ustring *strings, uint32_t strings_num){
+	for(uint32_t i = 0; i < strings_num; i++){
+		if(i + USTRING_PREFETCH_DISTANCE < strings_num){
+			USTRING_PREFETCH(&strings[i + USTRING_PREFETCH_DISTANCE]);
+		}
+		strings[i].clear();
+	}
+}
+
+uint32_t release_all(ustring *strings, uint32_t strings_num){
+	uint32_t released = 0;
+	/* From the end, so blocks that were allocated last are freed first */
+	for(uint32_t i = strings_num; i > 0; i--){
+		ustring *str = &strings[i - 1];
+		if(i > USTRING_PREFETCH_DISTANCE){
+			USTRING_PREFETCH(&strings[i - 1 - USTRING_PREFETCH_DISTANCE]);
+		}
+		uint32_t old_capacity = str->capacity();
+		if(old_capacity == 0){
+			continue;
+		}
+		str->clear();
+		if(str->shrink_to_fit() == true){
+			released += old_capacity - str->capacity();
+		}
+	}
+	return released;
+}
+
+void hash_all(const uvector<ustring> &strings, uint32_t *hashes){
+	hash_all(strings.data(), strings.size(), hashes);
+}
+
+void compare_all_to(const uvector<ustring> &strings, const char *key, int32_t *results){
+	compare_all_to(strings.data(), strings.size(), key, results);
+}
+
+void find_in_all(const uvector<ustring> &strings, const char *pattern, ustr_size_t *positions){
+	find_in_all(strings.data(), strings.size(), pattern, positions);
+}
+
+uint64_t total_size(const uvector<ustring> &strings){
+	return total_size(strings.data(), strings.size());
+}
+
+void recycle_all(uvector<ustring> &strings){
+	recycle_all(strings.data(), strings.size());
+}
+
+uint32_t release_all(uvector<ustring> &strings){
+	return release_all(strings.data(), strings.size());
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <string.h>
+#include "ustring_binlog.h"
+
+#define MAX_VARINT_SIZE					10
+
+static uint8_t* put_varint(uint8_t *dst, uint64_t val){
+	while(val >= 0x80){
+		*dst++ = (uint8_t)val | 0x80;
+		val >>= 7;
+	}
+	*dst++ = (uint8_t)val;
+	return dst;
+}
+
+static bool get_varint(const uint8_t *data, ustr_size_t len, ustr_size_t *pos, uint64_t *val){
+	*val = 0;
+	for(uint32_t shift = 0; (shift < 64) && (*pos < len); shift += 7){
+		uint8_t byte = data[(*pos)++];
+		*val |= (uint64_t)(byte & 0x7F) << shift;
+		if((byte & 0x80) == 0){
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ustring_binlog_write_args(ustring &out, uint32_t fmt_id, const ustring_fmt_arg_t *args, uint32_t args_num){
+	if(args_num > USTRING_FORMAT_MAX_ARGS){
+		return false;
+	}
+	ustr_size_t str_len[USTRING_FORMAT_MAX_ARGS];
+	uint64_t max_size = MAX_VARINT_SIZE + 1;//sum of string lengths is checked on every step, it can't wrap
+	for(uint32_t i = 0; i < args_num; i++){
+		max_size += 1 + MAX_VARINT_SIZE;
+		if(args[i].type == USTRING_ARG_STR){
+			str_len[i] = 0;
+			if(args[i].val.s != NULL){
+				str_len[i] = (args[i].len != ustring::npos) ? args[i].len : strlen(args[i].val.s);
+			}
+			if((uint64_t)str_len[i] >= (uint64_t)ustring::npos - max_size){
+				return false;
+			}
+			max_size += str_len[i];
+		}
+	}
+	ustr_size_t old_size = out.size();
+	if(max_size >= (uint64_t)ustring::npos - old_size){
+		return false;
+	}
+	uint8_t *dst = (uint8_t*)out.append_buffer((ustr_size_t)max_size);
+	if(dst == NULL){
+		return false;
+	}
+
+	uint8_t *start = dst;
+	dst = put_varint(dst, fmt_id);
+	*dst++ = args_num;
+	for(uint32_t i = 0; i < args_num; i++){
+		*dst++ = args[i].type;
+		switch(args[i].type){
+			case USTRING_ARG_INT:
+				dst = put_varint(dst, ((uint64_t)args[i].val.i << 1) ^ (uint64_t)(args[i].val.i >> 63));//zigzag
+				break;
+			case USTRING_ARG_DOUBLE:
+				memcpy(dst, &args[i].val.d, sizeof(double));
+				dst += sizeof(double);
+				break;
+			case USTRING_ARG_STR:
+				dst = put_varint(dst, str_len[i]);
+				memcpy(dst, args[i].val.s, str_len[i]);
+				dst += str_len[i];
+				break;
+			case USTRING_ARG_PTR:
+				dst = put_varint(dst, (uintptr_t)args[i].val.p);
+				break;
+			default:
+				dst = put_varint(dst, args[i].val.u);
+				break;
+		}
+	}
+	return out.resize(old_size + (dst - start));
+}
+
+bool ustring_binlog_decode(const uint8_t *data, ustr_size_t len, ustr_size_t *pos, const char *const *formats, uint32_t formats_num, ustring &out){
+	uint64_t fmt_id;
+	if((get_varint(data, len, pos, &fmt_id) != true) || (fmt_id >= formats_num) || (*pos >= len)){
+		return false;
+	}
+	uint32_t args_num = data[(*pos)++];
+	if(args_num > USTRING_FORMAT_MAX_ARGS){
+		return false;
+	}
+
+	ustring_fmt_arg_t args[USTRING_FORMAT_MAX_ARGS];
+	for(uint32_t i = 0; i < args_num; i++){
+		if(*pos >= len){
+			return false;
+		}
+		args[i].type = data[(*pos)++];
+		uint64_t val;
+		switch(args[i].type){
+			case USTRING_ARG_DOUBLE:
+				if((uint64_t)(len - *pos) < (uint64_t)sizeof(double)){
+					return false;
+				}
+				memcpy(&args[i].val.d, data + *pos, sizeof(double));
+				*pos += sizeof(double);
+				continue;
+			case USTRING_ARG_INT:
+			case USTRING_ARG_UINT:
+			case USTRING_ARG_STR:
+				break;
+			case USTRING_ARG_PTR://pointer of device can't be used on host
+				args[i].type = USTRING_ARG_UINT;
+				break;
+			default:
+				return false;
+		}
+		if(get_varint(data, len, pos, &val) != true){
+			return false;
+		}
+		if(args[i].type == USTRING_ARG_INT){
+			args[i].val.i = (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+		}
+		else if(args[i].type == USTRING_ARG_STR){
+			if(val > (uint64_t)(len - *pos)){
+				return false;
+			}
+			args[i].len = val;
+			args[i].val.s = (const char*)data + *pos;//string is formatted right from the log buffer
+			*pos += val;
+		}
+		else{
+			args[i].val.u = val;
+		}
+	}
+
+	const char *fmt = formats[fmt_id];
+	ustr_size_t text_len = ustring_format_args(NULL, 0, fmt, args, args_num);
+	if(text_len == ustring::npos){
+		return false;//arguments don't match format
+	}
+	char *dst = out.append_buffer(text_len);
+	if(dst == NULL){
+		return false;
+	}
+	ustring_format_args(dst, text_len + 1, fmt, args, args_num);
+	return true;
+}
+
+uint32_t ustring_binlog_decode_all(const uint8_t *data, ustr_size_t len, const char *const *formats, uint32_t formats_num, ustring &out){
+	ustr_size_t pos = 0;
+	uint32_t num = 0;
+	while((pos < len) && ustring_binlog_decode(data, len, &pos, formats, formats_num, out)){
+		num++;
+	}
+	return num;
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "ustring_budget.h"
+
+#ifdef USTRING_USE_THREADS
+#include <atomic>
+typedef std::atomic<uint32_t> budget_counter_t;//strings of different threads can share a domain
+#else
+typedef uint32_t budget_counter_t;
+#endif
+
+typedef struct{
+	budget_counter_t quota;
+	budget_counter_t usage;
+} budget_domain_t;
+
+static budget_domain_t budget_domains[USTRING_MAX_BUDGET_DOMAINS];
+
+bool ustring_budget_set_quota(uint8_t domain, uint32_t quota){
+	if(domain >= USTRING_MAX_BUDGET_DOMAINS){
+		return false;
+	}
+	budget_domains[domain].quota = quota;
+	return true;
+}
+
+uint32_t ustring_budget_get_quota(uint8_t domain){
+	if(domain >= USTRING_MAX_BUDGET_DOMAINS){
+		return 0;
+	}
+	return budget_domains[domain].quota;
+}
+
+uint32_t ustring_budget_get_usage(uint8_t domain){
+	if(domain >= USTRING_MAX_BUDGET_DOMAINS){
+		return 0;
+	}
+	return budget_domains[domain].usage;
+}
+
+bool ustring_budget_allows(uint8_t domain, uint32_t old_bytes, uint32_t new_bytes){
+	if((domain >= USTRING_MAX_BUDGET_DOMAINS) || (budget_domains[domain].quota == 0) || (new_bytes <= old_bytes)){
+		return true;
+	}
+	return (uint64_t)budget_domains[domain].usage + (new_bytes - old_bytes) <= budget_domains[domain].quota;
+}
+
+bool ustring_budget_try_charge(uint8_t domain, uint32_t old_bytes, uint32_t new_bytes){
+	if(domain >= USTRING_MAX_BUDGET_DOMAINS){
+		return true;
+	}
+	budget_domain_t *item = &budget_domains[domain];
+	uint32_t quota = item->quota;
+	if((quota == 0) || (new_bytes <= old_bytes)){
+		ustring_budget_charge(domain, old_bytes, new_bytes);
+		return true;
+	}
+	uint32_t delta = new_bytes - old_bytes;
+#ifdef USTRING_USE_THREADS
+	/* Check and charge are one step, so concurrent growths can't exceed quota together */
+	uint32_t usage = item->usage.load(std::memory_order_relaxed);
+	do{
+		if((uint64_t)usage + delta > quota){
+			return false;
+		}
+	}while(item->usage.compare_exchange_weak(usage, usage + delta, std::memory_order_relaxed) != true);
+#else
+	if((uint64_t)item->usage + delta > quota){
+		return false;
+	}
+	item->usage += delta;
+#endif
+	return true;
+}
+
+void ustring_budget_charge(uint8_t domain, uint32_t old_bytes, uint32_t new_bytes){
+	if(domain >= USTRING_MAX_BUDGET_DOMAINS){
+		return;
+	}
+	budget_domains[domain].usage += new_bytes;
+	budget_domains[domain].usage -= old_bytes;
+}
@@ -0,0 +1,231 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "ustring_executor.h"
+
+#ifdef USTRING_USE_THREADS
+
+static thread_local ustring_executor *cur_executor = NULL;
+static thread_local int32_t cur_worker = -1;
+static thread_local heap_t *cur_heap = NULL;
+
+ustring_executor::ustring_executor(){
+	queued.store(0);
+	pending.store(0);
+	next_worker.store(0);
+	stopping = false;
+}
+
+ustring_executor::~ustring_executor(){
+	stop();
+}
+
+bool ustring_executor::start(uint32_t workers_num, heap_t **heaps){
+	if((workers_num == 0) || (workers.size() > 0)){
+		return false;
+	}
+	stopping = false;
+	for(uint32_t i = 0; i < workers_num; i++){
+		worker_t *worker = new worker_t;
+		worker->heap = (heaps != NULL) ? heaps[i] : NULL;
+		workers.push_back(worker);
+	}
+	for(uint32_t i = 0; i < workers_num; i++){
+		workers[i]->thread = std::thread(&ustring_executor::worker_loop, this, i);
+	}
+	return true;
+}
+
+void ustring_executor::stop(){
+	if(workers.size() == 0){
+		return;
+	}
+	wait();
+	{
+		std::lock_guard<std::mutex> lock(idle_lock);
+		stopping = true;
+	}
+	idle_cv.notify_all();
+	for(uint32_t i = 0; i < workers.size(); i++){
+		workers[i]->thread.join();
+	}
+	for(uint32_t i = 0; i < workers.size(); i++){
+		delete workers[i];//workers that are still running can steal from any deque
+	}
+	workers.clear();
+}
+
+uint32_t ustring_executor::workers_num() const{
+	return workers.size();
+}
+
+void ustring_executor::push_task(task_t task){
+	if(workers.size() == 0){
+		task.fn(task.arg);//executor is not started
+		return;
+	}
+	pending.fetch_add(1);
+	uint32_t ind;
+	if((cur_executor == this) && (cur_worker >= 0)){
+		ind = cur_worker;//task of the task goes to the same worker, other workers steal it if they are idle
+	}
+	else{
+		ind = next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+	}
+	{
+		std::lock_guard<std::mutex> lock(workers[ind]->lock);
+		workers[ind]->tasks.push_back(task);
+	}
+	queued.fetch_add(1);
+	{
+		std::lock_guard<std::mutex> lock(idle_lock);//so worker can't miss notification between check and wait
+	}
+	idle_cv.notify_one();
+}
+
+bool ustring_executor::take_task(int32_t ind, task_t *task){
+	uint32_t workers_num = workers.size();
+	if(ind >= 0){
+		worker_t *worker = workers[ind];
+		std::lock_guard<std::mutex> lock(worker->lock);
+		if(!worker->tasks.empty()){
+			*task = worker->tasks.back();
+			worker->tasks.pop_back();
+			queued.fetch_sub(1);
+			return true;
+		}
+	}
+	uint32_t start = (ind >= 0) ? ind + 1 : next_worker.load(std::memory_order_relaxed);
+	for(uint32_t i = 0; i < workers_num; i++){
+		worker_t *victim = workers[(start + i) % workers_num];
+		std::lock_guard<std::mutex> lock(victim->lock);
+		if(!victim->tasks.empty()){
+			*task = victim->tasks.front();//steal the oldest task, it's usually the biggest one
+			victim->tasks.pop_front();
+			queued.fetch_sub(1);
+			return true;
+		}
+	}
+	return false;
+}
+
+void ustring_executor::run_task(task_t *task){
+	task->fn(task->arg);
+	if(pending.fetch_sub(1) == 1){
+		std::lock_guard<std::mutex> lock(done_lock);
+		done_cv.notify_all();
+	}
+}
+
+void ustring_executor::worker_loop(uint32_t ind){
+	cur_executor = this;
+	cur_worker = ind;
+	cur_heap = workers[ind]->heap;
+
+	task_t task;
+	while(1){
+		if(take_task(ind, &task)){
+			run_task(&task);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(idle_lock);
+		idle_cv.wait(lock, [this]{ return stopping || (queued.load() > 0); });
+		if(stopping && (queued.load() == 0)){
+			break;
+		}
+	}
+}
+
+void ustring_executor::submit(ustring_task_fn_t fn, void *arg){
+	task_t task = {fn, arg};
+	push_task(task);
+}
+
+void ustring_executor::wait(){
+	std::unique_lock<std::mutex> lock(done_lock);
+	done_cv.wait(lock, [this]{ return pending.load() == 0; });
+}
+
+typedef struct{
+	ustring_for_fn_t fn;
+	void *ctx;
+	uint32_t count;
+	std::atomic<uint32_t> next_ind;
+	std::atomic<uint32_t> active_tasks;
+} for_ctx_t;
+
+static void for_loop(for_ctx_t *ctx){
+	uint32_t ind;
+	while((ind = ctx->next_ind.fetch_add(1, std::memory_order_relaxed)) < ctx->count){
+		ctx->fn(ind, ctx->ctx);
+	}
+}
+
+static void for_task(void *arg){
+	for_ctx_t *ctx = (for_ctx_t*)arg;
+	for_loop(ctx);
+	ctx->active_tasks.fetch_sub(1, std::memory_order_release);
+}
+
+void ustring_executor::parallel_for(uint32_t count, ustring_for_fn_t fn, void *ctx){
+	if(count == 0){
+		return;
+	}
+	for_ctx_t for_ctx;
+	for_ctx.fn = fn;
+	for_ctx.ctx = ctx;
+	for_ctx.count = count;
+	for_ctx.next_ind.store(0);
+
+	/* Indexes are taken dynamically from shared counter, so one task per worker is enough */
+	uint32_t tasks_num = (count - 1 < workers.size()) ? count - 1 : workers.size();
+	for_ctx.active_tasks.store(tasks_num);
+	for(uint32_t i = 0; i < tasks_num; i++){
+		submit(for_task, &for_ctx);
+	}
+	for_loop(&for_ctx);
+
+	/* Help with other tasks while waiting, so nested parallel_for can't deadlock */
+	int32_t ind = (cur_executor == this) ? cur_worker : -1;
+	task_t task;
+	while(for_ctx.active_tasks.load(std::memory_order_acquire) > 0){
+		if(take_task(ind, &task)){
+			run_task(&task);
+		}
+		else{
+			std::this_thread::yield();
+		}
+	}
+}
+
+heap_t* ustring_executor::current_heap(){
+	return cur_heap;
+}
+
+int32_t ustring_executor::current_worker(){
+	return cur_worker;
+}
+
+#ifndef USE_SINGLE_HEAP_MEMORY
+heap_t* ustring_worker_heap_policy(ustr_size_t size, uint8_t tag, heap_t *current){
+	(void)size;
+	(void)tag;
+	(void)current;
+	return cur_heap;//NULL outside of workers, so string keeps its heap
+}
+#endif
+
+#endif // USTRING_USE_THREADS
@@ -0,0 +1,709 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include "ustring_format.h"
+
+#define SPEC_FROM_ARGS					-2//width or precision is "*"
+#define MAX_SPEC_NUMBER					100000000//width and precision are saturated, so lengths fit to int32_t
+#define FLOAT_BIG_LIMBS					82//mantissa * 5^1074 of the smallest subnormal takes 2547 bits
+#define FLOAT_MAX_DIGITS				774//767 decimal digits of that number, rounded up to groups of 9
+
+typedef enum{
+	LEN_NONE = 0,
+	LEN_HH,
+	LEN_H,
+	LEN_L,
+	LEN_LL,
+	LEN_Z,
+	LEN_J,
+	LEN_T
+} length_mod_t;
+
+typedef struct{
+	bool left;
+	bool plus;
+	bool space;
+	bool zero;
+	bool alt;//"#" flag
+	int32_t width;//-1 if not set
+	int32_t precision;//-1 if not set
+	uint8_t length;
+	char conv;
+} fmt_spec_t;
+
+typedef struct{
+	char *out;
+	ustr_size_t out_size;
+	uint64_t pos;//can be longer than ustr_size_t, such result is reported as error
+} writer_t;
+
+typedef struct{
+	uint32_t limbs[FLOAT_BIG_LIMBS];
+	uint32_t len;
+} big_uint_t;
+
+/* Exact decimal form of double: value is 0.d0d1d2... * 10^point */
+typedef struct{
+	char digits[FLOAT_MAX_DIGITS];
+	int32_t len;//number of digits without trailing zeros, 0 if value is zero
+	int32_t point;//number of digits before decimal point, can be negative
+} decimal_t;
+
+static inline void put_char(writer_t *w, char ch){
+	if(w->pos + 1 < w->out_size){
+		w->out[w->pos] = ch;
+	}
+	w->pos++;
+}
+
+static void put_chars(writer_t *w, const char *str, ustr_size_t len){
+	if(w->pos + 1 < w->out_size){
+		uint64_t fit = w->out_size - 1 - w->pos;
+		memcpy(w->out + w->pos, str, (len < fit) ? len : fit);
+	}
+	w->pos += len;
+}
+
+static void put_fill(writer_t *w, char ch, int32_t num){
+	for(int32_t i = 0; i < num; i++){
+		put_char(w, ch);
+	}
+}
+
+static const char* parse_number(const char *fmt, int32_t *num){
+	*num = 0;
+	while((*fmt >= '0') && (*fmt <= '9')){
+		if(*num < MAX_SPEC_NUMBER){
+			*num = *num * 10 + (*fmt - '0');
+		}
+		fmt++;
+	}
+	return fmt;
+}
+
+/* fmt points to the symbol after '%', returns pointer to the symbol after conversion */
+static const char* parse_spec(const char *fmt, fmt_spec_t *spec){
+	memset(spec, 0, sizeof(fmt_spec_t));
+	spec->width = -1;
+	spec->precision = -1;
+
+	while(1){
+		if(*fmt == '-'){
+			spec->left = true;
+		}
+		else if(*fmt == '+'){
+			spec->plus = true;
+		}
+		else if(*fmt == ' '){
+			spec->space = true;
+		}
+		else if(*fmt == '0'){
+			spec->zero = true;
+		}
+		else if(*fmt == '#'){
+			spec->alt = true;
+		}
+		else{
+			break;
+		}
+		fmt++;
+	}
+
+	if(*fmt == '*'){
+		spec->width = SPEC_FROM_ARGS;
+		fmt++;
+	}
+	else if((*fmt >= '0') && (*fmt <= '9')){
+		fmt = parse_number(fmt, &spec->width);
+	}
+
+	if(*fmt == '.'){
+		fmt++;
+		if(*fmt == '*'){
+			spec->precision = SPEC_FROM_ARGS;
+			fmt++;
+		}
+		else{
+			fmt = parse_number(fmt, &spec->precision);
+		}
+	}
+
+	switch(*fmt){
+		case 'h':
+			fmt++;
+			spec->length = LEN_H;
+			if(*fmt == 'h'){
+				fmt++;
+				spec->length = LEN_HH;
+			}
+			break;
+		case 'l':
+			fmt++;
+			spec->length = LEN_L;
+			if(*fmt == 'l'){
+				fmt++;
+				spec->length = LEN_LL;
+			}
+			break;
+		case 'z':
+			fmt++;
+			spec->length = LEN_Z;
+			break;
+		case 'j':
+			fmt++;
+			spec->length = LEN_J;
+			break;
+		case 't':
+			fmt++;
+			spec->length = LEN_T;
+			break;
+		case 'L':
+			fmt++;
+			break;
+		default:
+			break;
+	}
+
+	spec->conv = *fmt;
+	if(*fmt != '\0'){
+		fmt++;
+	}
+	return fmt;
+}
+
+static bool is_signed_conv(char conv){
+	return (conv == 'd') || (conv == 'i');
+}
+
+static bool is_unsigned_conv(char conv){
+	return (conv == 'u') || (conv == 'x') || (conv == 'X') || (conv == 'o');
+}
+
+static bool is_float_conv(char conv){
+	return (conv == 'f') || (conv == 'F') || (conv == 'e') || (conv == 'E') || (conv == 'g') || (conv == 'G');
+}
+
+uint32_t ustring_collect_args(const char *fmt, va_list va, ustring_fmt_arg_t *args, uint32_t max_args){
+	uint32_t num = 0;
+	fmt_spec_t spec;
+	while((*fmt != '\0') && (num < max_args)){
+		if(*fmt++ != '%'){
+			continue;
+		}
+		fmt = parse_spec(fmt, &spec);
+		if(spec.width == SPEC_FROM_ARGS){
+			args[num].type = USTRING_ARG_INT;
+			args[num++].val.i = va_arg(va, int);
+		}
+		if((spec.precision == SPEC_FROM_ARGS) && (num < max_args)){
+			args[num].type = USTRING_ARG_INT;
+			args[num++].val.i = va_arg(va, int);
+		}
+		if((num >= max_args) || (spec.conv == '%') || (spec.conv == '\0')){
+			continue;
+		}
+
+		ustring_fmt_arg_t *arg = &args[num];
+		if(is_signed_conv(spec.conv) || (spec.conv == 'c')){
+			arg->type = USTRING_ARG_INT;
+			switch(spec.length){
+				case LEN_L:		arg->val.i = va_arg(va, long);				break;
+				case LEN_LL:	arg->val.i = va_arg(va, long long);			break;
+				case LEN_Z:		arg->val.i = va_arg(va, ptrdiff_t);			break;//signed size_t
+				case LEN_J:		arg->val.i = va_arg(va, intmax_t);			break;
+				case LEN_T:		arg->val.i = va_arg(va, ptrdiff_t);			break;
+				default:		arg->val.i = va_arg(va, int);				break;
+			}
+		}
+		else if(is_unsigned_conv(spec.conv)){
+			arg->type = USTRING_ARG_UINT;
+			switch(spec.length){
+				case LEN_L:		arg->val.u = va_arg(va, unsigned long);		break;
+				case LEN_LL:	arg->val.u = va_arg(va, unsigned long long);	break;
+				case LEN_Z:		arg->val.u = va_arg(va, size_t);				break;
+				case LEN_J:		arg->val.u = va_arg(va, uintmax_t);			break;
+				case LEN_T:		arg->val.u = va_arg(va, size_t);				break;
+				default:		arg->val.u = va_arg(va, unsigned int);		break;
+			}
+		}
+		else if(is_float_conv(spec.conv)){
+			arg->type = USTRING_ARG_DOUBLE;
+			arg->val.d = va_arg(va, double);
+		}
+		else if(spec.conv == 's'){
+			arg->type = USTRING_ARG_STR;
+			arg->len = ustring::npos;
+			arg->val.s = va_arg(va, const char*);
+		}
+		else if(spec.conv == 'p'){
+			arg->type = USTRING_ARG_PTR;
+			arg->val.p = va_arg(va, const void*);
+		}
+		else{
+			continue;//unknown conversion doesn't take arguments
+		}
+		num++;
+	}
+	return num;
+}
+
+static int64_t arg_to_int(const ustring_fmt_arg_t *arg){
+	switch(arg->type){
+		case USTRING_ARG_UINT:		return (int64_t)arg->val.u;
+		case USTRING_ARG_DOUBLE:	return (int64_t)arg->val.d;
+		case USTRING_ARG_STR:
+		case USTRING_ARG_PTR:		return (int64_t)(uintptr_t)arg->val.p;
+		default:					return arg->val.i;
+	}
+}
+
+static double arg_to_double(const ustring_fmt_arg_t *arg){
+	switch(arg->type){
+		case USTRING_ARG_INT:		return (double)arg->val.i;
+		case USTRING_ARG_UINT:		return (double)arg->val.u;
+		case USTRING_ARG_DOUBLE:	return arg->val.d;
+		default:					return 0;
+	}
+}
+
+/* Writes [spaces][sign][prefix][zeros] according to width and flags for body of body_len symbols,
+ * returns number of spaces that should be written after the body */
+static int32_t put_padding(writer_t *w, const fmt_spec_t *spec, char sign, const char *prefix, int32_t zeros, int32_t body_len){
+	int32_t prefix_len = strlen(prefix);
+	int32_t total = (sign != 0) + prefix_len + zeros + body_len;
+	int32_t pad = (spec->width > total) ? spec->width - total : 0;
+	if(spec->zero && !spec->left && (spec->precision < 0 || is_float_conv(spec->conv))){
+		zeros += pad;//zero padding goes between sign and digits
+		pad = 0;
+	}
+
+	if(!spec->left){
+		put_fill(w, ' ', pad);
+	}
+	if(sign != 0){
+		put_char(w, sign);
+	}
+	put_chars(w, prefix, prefix_len);
+	put_fill(w, '0', zeros);
+	return spec->left ? pad : 0;
+}
+
+/* Writes [spaces][sign][prefix][zeros][body][spaces] */
+static void put_padded(writer_t *w, const fmt_spec_t *spec, char sign, const char *prefix, int32_t zeros, const char *body, int32_t body_len){
+	int32_t pad = put_padding(w, spec, sign, prefix, zeros, body_len);
+	put_chars(w, body, body_len);
+	put_fill(w, ' ', pad);
+}
+
+static char get_sign(const fmt_spec_t *spec, bool negative){
+	if(negative){
+		return '-';
+	}
+	if(spec->plus){
+		return '+';
+	}
+	return spec->space ? ' ' : 0;
+}
+
+static void put_integer(writer_t *w, const fmt_spec_t *spec, uint64_t val, bool negative, uint32_t base, const char *prefix){
+	const char *digits_set = (spec->conv == 'X') ? "0123456789ABCDEF" : "0123456789abcdef";
+	char digits[24];
+	int32_t len = 0;
+	while(val > 0){
+		digits[sizeof(digits) - 1 - len++] = digits_set[val % base];
+		val /= base;
+	}
+	if((len == 0) && (spec->precision != 0)){
+		digits[sizeof(digits) - 1 - len++] = '0';
+	}
+	int32_t zeros = (spec->precision > len) ? spec->precision - len : 0;
+	if(spec->alt && (base == 8) && (zeros == 0) && ((len == 0) || (digits[sizeof(digits) - len] != '0'))){
+		zeros = 1;//"#o" always starts with 0
+	}
+	put_padded(w, spec, get_sign(spec, negative), prefix, zeros, &digits[sizeof(digits) - len], len);
+}
+
+static void big_mul(big_uint_t *big, uint32_t mul){
+	uint64_t carry = 0;
+	for(uint32_t i = 0; i < big->len; i++){
+		uint64_t val = (uint64_t)big->limbs[i] * mul + carry;
+		big->limbs[i] = (uint32_t)val;
+		carry = val >> 32;
+	}
+	if(carry != 0){
+		big->limbs[big->len++] = (uint32_t)carry;
+	}
+}
+
+static void big_shift_left(big_uint_t *big, uint32_t shift){
+	uint32_t words = shift / 32;
+	uint32_t bits = shift % 32;
+	big->limbs[big->len + words] = 0;
+	for(int32_t i = big->len - 1; i >= 0; i--){
+		big->limbs[i + words + 1] |= (bits != 0) ? (big->limbs[i] >> (32 - bits)) : 0;
+		big->limbs[i + words] = big->limbs[i] << bits;
+	}
+	for(uint32_t i = 0; i < words; i++){
+		big->limbs[i] = 0;
+	}
+	big->len += words + 1;
+	while((big->len > 0) && (big->limbs[big->len - 1] == 0)){
+		big->len--;
+	}
+}
+
+/* Returns remainder */
+static uint32_t big_div(big_uint_t *big, uint32_t div){
+	uint64_t rem = 0;
+	for(int32_t i = big->len - 1; i >= 0; i--){
+		uint64_t val = (rem << 32) | big->limbs[i];
+		big->limbs[i] = (uint32_t)(val / div);
+		rem = val % div;
+	}
+	while((big->len > 0) && (big->limbs[big->len - 1] == 0)){
+		big->len--;
+	}
+	return (uint32_t)rem;
+}
+
+/* Finite positive double is mantissa * 2^exp, it's converted to decimal digits exactly: mantissa * 2^exp
+ * is integer if exp >= 0, and mantissa * 5^-exp / 10^-exp otherwise */
+static void to_decimal(decimal_t *dec, double val){
+	uint64_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	uint64_t mantissa = bits & ((1ULL << 52) - 1);
+	int32_t exp = (int32_t)((bits >> 52) & 0x7FF);
+	if(exp == 0){
+		exp = -1074;//subnormal
+	}
+	else{
+		mantissa |= 1ULL << 52;
+		exp -= 1075;
+	}
+	if(mantissa == 0){
+		dec->len = 0;
+		dec->point = 1;
+		return;
+	}
+	while(((mantissa & 1) == 0) && (exp < 0)){
+		mantissa >>= 1;
+		exp++;
+	}
+
+	big_uint_t big;
+	big.limbs[0] = (uint32_t)mantissa;
+	big.limbs[1] = (uint32_t)(mantissa >> 32);
+	big.len = (big.limbs[1] != 0) ? 2 : 1;
+	if(exp >= 0){
+		big_shift_left(&big, exp);
+	}
+	else{
+		int32_t pow5 = -exp;
+		for(; pow5 >= 13; pow5 -= 13){
+			big_mul(&big, 1220703125UL);//5^13
+		}
+		uint32_t mul = 1;
+		while(pow5-- > 0){
+			mul *= 5;
+		}
+		big_mul(&big, mul);
+	}
+
+	int32_t pos = FLOAT_MAX_DIGITS;
+	do{
+		uint32_t group = big_div(&big, 1000000000UL);
+		for(int32_t i = 0; i < 9; i++){
+			dec->digits[--pos] = '0' + group % 10;
+			group /= 10;
+		}
+	}while(big.len > 0);
+	while(dec->digits[pos] == '0'){
+		pos++;
+	}
+	int32_t len = FLOAT_MAX_DIGITS - pos;
+	memmove(dec->digits, dec->digits + pos, len);
+	dec->point = (exp < 0) ? len + exp : len;
+	while(dec->digits[len - 1] == '0'){
+		len--;
+	}
+	dec->len = len;
+}
+
+/* Keeps first digits, exact ties are rounded to even like printf does */
+static void round_decimal(decimal_t *dec, int32_t keep){
+	if(keep >= dec->len){
+		return;
+	}
+	bool up = false;
+	if(keep >= 0){
+		char next = dec->digits[keep];
+		bool odd = (keep > 0) && (((dec->digits[keep - 1] - '0') & 1) != 0);
+		up = (next > '5') || ((next == '5') && ((keep + 1 < dec->len) || odd));//digits after the last one are not zeros
+	}
+	dec->len = (keep > 0) ? keep : 0;
+	if(up){
+		int32_t i = keep - 1;
+		while((i >= 0) && (dec->digits[i] == '9')){
+			i--;
+		}
+		if(i < 0){
+			dec->digits[0] = '1';//all digits were 9, or rounding digit was the first one
+			dec->len = 1;
+			dec->point++;
+		}
+		else{
+			dec->digits[i]++;
+			dec->len = i + 1;
+		}
+	}
+	while((dec->len > 0) && (dec->digits[dec->len - 1] == '0')){
+		dec->len--;
+	}
+	if(dec->len == 0){
+		dec->point = 1;
+	}
+}
+
+/* Writes digits [from, from + num), digits out of significant ones are zeros */
+static void put_digits(writer_t *w, const decimal_t *dec, int32_t from, int32_t num){
+	int32_t end = from + num;
+	if((from < 0) && (from < end)){
+		int32_t zeros = (end < 0) ? num : -from;
+		put_fill(w, '0', zeros);
+		from += zeros;
+	}
+	if((from < dec->len) && (from < end)){
+		int32_t len = ((end < dec->len) ? end : dec->len) - from;
+		put_chars(w, dec->digits + from, len);
+		from += len;
+	}
+	put_fill(w, '0', end - from);
+}
+
+static void put_float(writer_t *w, fmt_spec_t *spec, double val){
+	bool negative = signbit(val);
+	bool upper = (spec->conv == 'F') || (spec->conv == 'E') || (spec->conv == 'G');
+	fmt_spec_t float_spec = *spec;
+	float_spec.precision = -1;
+	if(isnan(val) || isinf(val)){
+		const char *str = isnan(val) ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf");
+		float_spec.zero = false;
+		put_padded(w, &float_spec, get_sign(spec, negative), "", 0, str, 3);
+		return;
+	}
+
+	decimal_t dec;
+	to_decimal(&dec, negative ? -val : val);
+	int32_t precision = (spec->precision < 0) ? 6 : spec->precision;
+	char conv = upper ? spec->conv - 'A' + 'a' : spec->conv;
+	if(conv == 'g'){
+		if(precision == 0){
+			precision = 1;
+		}
+		round_decimal(&dec, precision);
+		int32_t exp10 = dec.point - 1;
+		if((exp10 < precision) && (exp10 >= -4)){
+			conv = 'f';
+			precision -= exp10 + 1;
+		}
+		else{
+			conv = 'e';
+			precision--;
+		}
+		if(!spec->alt){//trailing zeros are removed
+			int32_t frac_digits = dec.len - ((conv == 'f') ? dec.point : 1);
+			if(precision > frac_digits){
+				precision = (frac_digits > 0) ? frac_digits : 0;
+			}
+		}
+	}
+	else if(conv == 'e'){
+		round_decimal(&dec, precision + 1);
+	}
+	else{
+		round_decimal(&dec, dec.point + precision);
+	}
+
+	bool dot = (precision > 0) || spec->alt;
+	if(conv == 'f'){
+		int32_t int_len = (dec.point > 0) ? dec.point : 1;
+		int32_t pad = put_padding(w, &float_spec, get_sign(spec, negative), "", 0, int_len + dot + precision);
+		put_digits(w, &dec, (dec.point > 0) ? 0 : -1, int_len);
+		if(dot){
+			put_char(w, '.');
+		}
+		put_digits(w, &dec, dec.point, precision);
+		put_fill(w, ' ', pad);
+		return;
+	}
+
+	int32_t exp10 = (dec.len > 0) ? dec.point - 1 : 0;
+	uint32_t exp_abs = (exp10 < 0) ? -exp10 : exp10;
+	char exp_str[8];
+	int32_t exp_len = 0;
+	exp_str[exp_len++] = upper ? 'E' : 'e';
+	exp_str[exp_len++] = (exp10 < 0) ? '-' : '+';
+	if(exp_abs >= 100){
+		exp_str[exp_len++] = '0' + exp_abs / 100;
+	}
+	exp_str[exp_len++] = '0' + exp_abs / 10 % 10;
+	exp_str[exp_len++] = '0' + exp_abs % 10;
+
+	int32_t pad = put_padding(w, &float_spec, get_sign(spec, negative), "", 0, 1 + dot + precision + exp_len);
+	put_digits(w, &dec, 0, 1);
+	if(dot){
+		put_char(w, '.');
+	}
+	put_digits(w, &dec, 1, precision);
+	put_chars(w, exp_str, exp_len);
+	put_fill(w, ' ', pad);
+}
+
+ustr_size_t ustring_format_args(char *out, ustr_size_t out_size, const char *fmt, const ustring_fmt_arg_t *args, uint32_t args_num){
+	writer_t w = {out, out_size, 0};
+	uint32_t arg_ind = 0;
+	fmt_spec_t spec;
+	static const ustring_fmt_arg_t empty_arg = {USTRING_ARG_INT, 0, {0}};
+	bool missing_args = false;
+
+	while(*fmt != '\0'){
+		const char *start = fmt;
+		while((*fmt != '\0') && (*fmt != '%')){
+			fmt++;
+		}
+		put_chars(&w, start, fmt - start);
+		if(*fmt == '\0'){
+			break;
+		}
+
+		fmt = parse_spec(fmt + 1, &spec);
+		if(spec.width == SPEC_FROM_ARGS){
+			missing_args |= (arg_ind >= args_num);
+			int64_t width = arg_to_int((arg_ind < args_num) ? &args[arg_ind++] : &empty_arg);
+			spec.left = spec.left || (width < 0);
+			width = (width < 0) ? -width : width;
+			spec.width = (width < MAX_SPEC_NUMBER) ? width : MAX_SPEC_NUMBER;
+		}
+		if(spec.precision == SPEC_FROM_ARGS){
+			missing_args |= (arg_ind >= args_num);
+			int64_t precision = arg_to_int((arg_ind < args_num) ? &args[arg_ind++] : &empty_arg);
+			spec.precision = (precision < 0) ? -1 : ((precision < MAX_SPEC_NUMBER) ? precision : MAX_SPEC_NUMBER);
+		}
+		if(spec.conv == '%'){
+			put_char(&w, '%');
+			continue;
+		}
+		if(spec.conv == '\0'){
+			break;
+		}
+
+		if(!is_signed_conv(spec.conv) && !is_unsigned_conv(spec.conv) && !is_float_conv(spec.conv) &&
+				(spec.conv != 'c') && (spec.conv != 's') && (spec.conv != 'p')){
+			continue;//unknown conversion doesn't take arguments
+		}
+		missing_args |= (arg_ind >= args_num);
+		const ustring_fmt_arg_t *arg = (arg_ind < args_num) ? &args[arg_ind++] : &empty_arg;
+		if(is_signed_conv(spec.conv)){
+			int64_t val = arg_to_int(arg);
+			if(spec.length == LEN_HH){
+				val = (signed char)val;
+			}
+			else if(spec.length == LEN_H){
+				val = (short)val;
+			}
+			put_integer(&w, &spec, (val < 0) ? -(uint64_t)val : (uint64_t)val, val < 0, 10, "");
+		}
+		else if(is_unsigned_conv(spec.conv)){
+			uint64_t val = (uint64_t)arg_to_int(arg);
+			if(spec.length == LEN_HH){
+				val = (unsigned char)val;
+			}
+			else if(spec.length == LEN_H){
+				val = (unsigned short)val;
+			}
+			spec.plus = false;
+			spec.space = false;
+			uint32_t base = (spec.conv == 'o') ? 8 : ((spec.conv == 'u') ? 10 : 16);
+			const char *prefix = "";
+			if(spec.alt && (base == 16) && (val != 0)){
+				prefix = (spec.conv == 'X') ? "0X" : "0x";
+			}
+			put_integer(&w, &spec, val, false, base, prefix);
+		}
+		else if(is_float_conv(spec.conv)){
+			put_float(&w, &spec, arg_to_double(arg));
+		}
+		else if(spec.conv == 'c'){
+			char ch = (char)arg_to_int(arg);
+			spec.precision = -1;
+			spec.zero = false;
+			put_padded(&w, &spec, 0, "", 0, &ch, 1);
+		}
+		else if(spec.conv == 's'){
+			const char *str = (arg->type == USTRING_ARG_STR) ? arg->val.s : NULL;
+			ustr_size_t len;
+			if(str == NULL){
+				str = "(null)";
+				len = 6;
+			}
+			else if(arg->len != ustring::npos){
+				len = arg->len;
+			}
+			else{
+				len = 0;
+				while((str[len] != '\0') && ((spec.precision < 0) || (len < (ustr_size_t)spec.precision))){
+					len++;
+				}
+			}
+			if((spec.precision >= 0) && (len > (ustr_size_t)spec.precision)){
+				len = spec.precision;
+			}
+			spec.precision = -1;
+			spec.zero = false;
+			put_padded(&w, &spec, 0, "", 0, str, len);
+		}
+		else if(spec.conv == 'p'){
+			spec.plus = false;
+			spec.space = false;
+			put_integer(&w, &spec, (uint64_t)(uintptr_t)arg->val.p, false, 16, "0x");
+		}
+	}
+
+	if(out_size > 0){
+		out[(w.pos < out_size) ? w.pos : out_size - 1] = '\0';
+	}
+	if(missing_args || (w.pos >= ustring::npos)){
+		return ustring::npos;
+	}
+	return w.pos;
+}
+
+ustr_size_t ustring_vformat(char *out, ustr_size_t out_size, const char *fmt, va_list va){
+	ustring_fmt_arg_t args[USTRING_FORMAT_MAX_ARGS];
+	uint32_t args_num = ustring_collect_args(fmt, va, args, USTRING_FORMAT_MAX_ARGS);
+	return ustring_format_args(out, out_size, fmt, args, args_num);
+}
+
+ustr_size_t ustring_format(char *out, ustr_size_t out_size, const char *fmt, ...){
+	va_list va;
+	va_start(va, fmt);
+	ustr_size_t res = ustring_vformat(out, out_size, fmt, va);
+	va_end(va);
+	return res;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <string.h>
+#include "ustring_hex.h"
+
+#ifdef USTRING_USE_SSSE3
+#include <tmmintrin.h>
+#endif
+
+static const char lower_digits[] = "0123456789abcdef";
+static const char upper_digits[] = "0123456789ABCDEF";
+
+#define INVALID_NIBBLE					0xFF
+
+static inline uint8_t nibble(char ch){
+	if((ch >= '0') && (ch <= '9')){
+		return ch - '0';
+	}
+	ch |= 0x20;//lower case
+	if((ch >= 'a') && (ch <= 'f')){
+		return ch - 'a' + 10;
+	}
+	return INVALID_NIBBLE;
+}
+
+#ifdef USTRING_USE_SSSE3
+/* Converts 16 bytes to 32 symbols */
+static inline void encode_block(char *dst, __m128i in, __m128i digits){
+	__m128i mask = _mm_set1_epi8(0x0F);
+	__m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(in, 4), mask));
+	__m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(in, mask));
+	_mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi8(high, low));
+	_mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi8(high, low));
+}
+
+/* Converts 16 symbols to 16 nibbles, returns false if there are not hex symbols */
+static inline bool decode_nibbles(__m128i in, __m128i *out){
+	__m128i digits = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+	__m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(digits, _mm_set1_epi8(-1)), _mm_cmplt_epi8(digits, _mm_set1_epi8(10)));
+	__m128i letters = _mm_sub_epi8(_mm_or_si128(in, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	__m128i is_letter = _mm_and_si128(_mm_cmpgt_epi8(letters, _mm_set1_epi8(-1)), _mm_cmplt_epi8(letters, _mm_set1_epi8(6)));
+	if(_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xFFFF){
+		return false;
+	}
+	letters = _mm_add_epi8(letters, _mm_set1_epi8(10));
+	*out = _mm_or_si128(_mm_and_si128(is_digit, digits), _mm_and_si128(is_letter, letters));
+	return true;
+}
+#endif
+
+void ustring_hex_encode(char *dst, const uint8_t *src, ustr_size_t src_len, bool upper){
+	const char *digits = upper ? upper_digits : lower_digits;
+	ustr_size_t i = 0;
+#ifdef USTRING_USE_SSSE3
+	__m128i lut = _mm_loadu_si128((const __m128i*)digits);
+	for(; src_len - i >= 16; i += 16){
+		encode_block(dst, _mm_loadu_si128((const __m128i*)(src + i)), lut);
+		dst += 32;
+	}
+#endif
+	for(; i < src_len; i++){
+		*dst++ = digits[src[i] >> 4];
+		*dst++ = digits[src[i] & 0x0F];
+	}
+}
+
+bool ustring_hex_decode(uint8_t *dst, const char *src, ustr_size_t src_len){
+	if(src_len % 2 != 0){
+		return false;
+	}
+	ustr_size_t i = 0;
+#ifdef USTRING_USE_SSSE3
+	for(; src_len - i >= 32; i += 32){
+		__m128i first, second;
+		if(!decode_nibbles(_mm_loadu_si128((const __m128i*)(src + i)), &first) ||
+				!decode_nibbles(_mm_loadu_si128((const __m128i*)(src + i + 16)), &second)){
+			return false;
+		}
+		/* high * 16 + low for every pair of nibbles */
+		first = _mm_maddubs_epi16(first, _mm_set1_epi16(0x0110));
+		second = _mm_maddubs_epi16(second, _mm_set1_epi16(0x0110));
+		_mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(first, second));
+		dst += 16;
+	}
+#endif
+	for(; i < src_len; i += 2){
+		uint8_t high = nibble(src[i]);
+		uint8_t low = nibble(src[i + 1]);
+		if((high == INVALID_NIBBLE) || (low == INVALID_NIBBLE)){
+			return false;
+		}
+		*dst++ = (high << 4) | low;
+	}
+	return true;
+}
+
+ustr_size_t ustring_hexdump_size(ustr_size_t src_len){
+	ustr_size_t full_lines = src_len / USTRING_HEXDUMP_LINE_BYTES;
+	ustr_size_t rest = src_len % USTRING_HEXDUMP_LINE_BYTES;
+	return full_lines * USTRING_HEXDUMP_LINE_SIZE + ((rest > 0) ? USTRING_HEXDUMP_LINE_SIZE - USTRING_HEXDUMP_LINE_BYTES + rest : 0);
+}
+
+void ustring_hexdump(char *dst, const uint8_t *src, ustr_size_t src_len, uint32_t offset){
+	for(ustr_size_t line = 0; line < src_len; line += USTRING_HEXDUMP_LINE_BYTES){
+		ustr_size_t num = src_len - line;
+		if(num > USTRING_HEXDUMP_LINE_BYTES){
+			num = USTRING_HEXDUMP_LINE_BYTES;
+		}
+		uint32_t addr = offset + line;
+		for(int32_t i = 7; i >= 0; i--){
+			*dst++ = lower_digits[(addr >> (i * 4)) & 0x0F];
+		}
+		*dst++ = ' ';
+
+		char hex[USTRING_HEXDUMP_LINE_BYTES * 2];
+		ustring_hex_encode(hex, src + line, num, false);
+		for(ustr_size_t i = 0; i < USTRING_HEXDUMP_LINE_BYTES; i++){
+			if(i % 8 == 0){
+				*dst++ = ' ';
+			}
+			if(i < num){
+				*dst++ = hex[i * 2];
+				*dst++ = hex[i * 2 + 1];
+			}
+			else{
+				*dst++ = ' ';
+				*dst++ = ' ';
+			}
+			*dst++ = ' ';
+		}
+
+		*dst++ = ' ';
+		*dst++ = '|';
+		for(ustr_size_t i = 0; i < num; i++){
+			uint8_t ch = src[line + i];
+			*dst++ = ((ch >= 0x20) && (ch < 0x7F)) ? ch : '.';
+		}
+		*dst++ = '|';
+		*dst++ = '\n';
+	}
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "ustring_idle.h"
+#include "ustring_pressure.h"
+
+/* Recursive, because growth in ustring_idle_step() can call pressure callbacks, and they can
+ * register or unregister strings */
+#ifdef USTRING_USE_THREADS
+#include <mutex>
+static std::recursive_mutex idle_mutex;
+#define IDLE_LOCK()						std::lock_guard<std::recursive_mutex> idle_lock(idle_mutex)
+#include <atomic>
+typedef std::atomic<uint32_t> idle_counter_t;//read without lock by destructors of all strings
+#else
+#define IDLE_LOCK()
+typedef uint32_t idle_counter_t;
+#endif
+
+typedef struct{
+	ustring *str;
+	ustr_size_t headroom;
+} idle_string_t;
+
+static idle_string_t idle_strings[USTRING_MAX_IDLE_STRINGS];
+static idle_counter_t idle_strings_num(0);
+static uint32_t next_string = 0;
+
+bool ustring_idle_register(ustring *str, ustr_size_t headroom){
+	IDLE_LOCK();
+	for(uint32_t i = 0; i < idle_strings_num; i++){
+		if(idle_strings[i].str == str){
+			idle_strings[i].headroom = headroom;
+			return true;
+		}
+	}
+	if(idle_strings_num >= USTRING_MAX_IDLE_STRINGS){
+		return false;
+	}
+	idle_strings[idle_strings_num].str = str;
+	idle_strings[idle_strings_num].headroom = headroom;
+	idle_strings_num++;
+	return true;
+}
+
+void ustring_idle_unregister(ustring *str){
+	if(idle_strings_num == 0){
+		return;//every string calls it in destructor
+	}
+	IDLE_LOCK();
+	for(uint32_t i = 0; i < idle_strings_num; i++){
+		if(idle_strings[i].str == str){
+			idle_strings[i] = idle_strings[--idle_strings_num];
+			return;
+		}
+	}
+}
+
+uint32_t ustring_idle_strings_num(){
+	return idle_strings_num;
+}
+
+uint32_t ustring_idle_step(ustring_time_fn_t now, uint32_t budget){
+	uint32_t start = (now != NULL) ? now() : 0;
+	uint32_t grown = 0;
+	IDLE_LOCK();
+	ustring_pressure_suspend(true);//headroom is optional, it shouldn't take memory of other strings
+
+	for(uint32_t i = 0; i < idle_strings_num; i++){
+		if(next_string >= idle_strings_num){
+			next_string = 0;
+		}
+		idle_string_t *item = &idle_strings[next_string++];
+		ustr_size_t size = item->str->size();
+		ustr_size_t max_headroom = item->str->max_size() - size;
+		ustr_size_t needed = size + ((item->headroom < max_headroom) ? item->headroom : max_headroom);
+		if(item->str->capacity() <= needed){
+			if(item->str->reserve(needed) == true){
+				grown++;
+			}
+		}
+
+		if((now == NULL) || (now() - start >= budget)){
+			break;
+		}
+	}
+	ustring_pressure_suspend(false);
+	return grown;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "ustring_intern.h"
+
+#if defined(USTRING_USE_THREADS) && !defined(USE_SINGLE_HEAP_MEMORY)
+
+#include <string.h>
+#include <mutex>
+
+#define INTERN_SHARD_BITS				24//id is shard index in high byte and string index in low bits
+#define INTERN_MIN_SLOTS				16
+
+static inline uint32_t get_shard_ind(uint32_t hash){
+	return hash & (USTRING_INTERN_SHARDS - 1);
+}
+
+static inline uint32_t get_first_slot(uint32_t hash, uint32_t slots_num){
+	return (hash >> 8) & (slots_num - 1);//low bits of hash select shard
+}
+
+ustring_intern_table::ustring_intern_table(){
+
+}
+
+bool ustring_intern_table::init(heap_t **heaps){
+	for(uint32_t i = 0; i < USTRING_INTERN_SHARDS; i++){
+		shards[i].strings.assign_mem_pointer(heaps[i]);
+		shards[i].hashes.assign_mem_pointer(heaps[i]);
+		shards[i].slots.assign_mem_pointer(heaps[i]);
+		if(shards[i].slots.resize(INTERN_MIN_SLOTS, 0) != true){
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t ustring_intern_table::find_in_shard(shard_t *shard, const char *str, ustr_size_t str_len, uint32_t hash){
+	uint32_t slots_num = shard->slots.size();
+	if(slots_num == 0){
+		return USTRING_INTERN_INVALID_ID;//table is not initialized
+	}
+	uint32_t slot = get_first_slot(hash, slots_num);
+	while(shard->slots.at(slot) != 0){
+		uint32_t ind = shard->slots.at(slot) - 1;
+		if((shard->hashes.at(ind) == hash) && (shard->strings.at(ind).compare(str, str_len) == 0)){
+			return ind;
+		}
+		slot = (slot + 1) & (slots_num - 1);
+	}
+	return USTRING_INTERN_INVALID_ID;
+}
+
+bool ustring_intern_table::grow_slots(shard_t *shard){
+	uint32_t new_slots_num = shard->slots.size() * 2;
+	if(shard->slots.resize(new_slots_num, 0) != true){
+		return false;//old index stays valid
+	}
+	for(uint32_t i = 0; i < new_slots_num; i++){
+		shard->slots.at(i) = 0;
+	}
+	for(uint32_t i = 0; i < shard->strings.size(); i++){
+		uint32_t slot = get_first_slot(shard->hashes.at(i), new_slots_num);
+		while(shard->slots.at(slot) != 0){
+			slot = (slot + 1) & (new_slots_num - 1);
+		}
+		shard->slots.at(slot) = i + 1;
+	}
+	return true;
+}
+
+uint32_t ustring_intern_table::intern(const char *str){
+	return intern(str, strlen(str));
+}
+
+uint32_t ustring_intern_table::intern(const char *str, ustr_size_t str_len){
+	uint32_t hash = ustring_hash(str, str_len);
+	uint32_t shard_ind = get_shard_ind(hash);
+	shard_t *shard = &shards[shard_ind];
+
+	uint32_t ind = find(str, str_len);
+	if(ind != USTRING_INTERN_INVALID_ID){
+		return ind;
+	}
+
+	std::unique_lock<std::shared_mutex> lock(shard->lock);
+	if(shard->slots.size() == 0){
+		return USTRING_INTERN_INVALID_ID;//init() wasn't called or failed
+	}
+	ind = find_in_shard(shard, str, str_len, hash);//string could be added while lock was released
+	if(ind != USTRING_INTERN_INVALID_ID){
+		return (shard_ind << INTERN_SHARD_BITS) | ind;
+	}
+
+	if((shard->strings.size() + 1) * 2 > shard->slots.size()){
+		if(grow_slots(shard) != true){
+			return USTRING_INTERN_INVALID_ID;
+		}
+	}
+	ind = shard->strings.size();
+	if(ind >= (1UL << INTERN_SHARD_BITS)){
+		return USTRING_INTERN_INVALID_ID;
+	}
+	if(shard->strings.push_back(ustring(shard->strings.get_mem_pointer())) != true){
+		return USTRING_INTERN_INVALID_ID;
+	}
+	if((shard->strings.at(ind).assign(str, str_len) != true) || (shard->hashes.push_back(hash) != true)){
+		shard->strings.pop_back();
+		return USTRING_INTERN_INVALID_ID;
+	}
+
+	uint32_t slot = get_first_slot(hash, shard->slots.size());
+	while(shard->slots.at(slot) != 0){
+		slot = (slot + 1) & (shard->slots.size() - 1);
+	}
+	shard->slots.at(slot) = ind + 1;
+	return (shard_ind << INTERN_SHARD_BITS) | ind;
+}
+
+uint32_t ustring_intern_table::find(const char *str){
+	return find(str, strlen(str));
+}
+
+uint32_t ustring_intern_table::find(const char *str, ustr_size_t str_len){
+	uint32_t hash = ustring_hash(str, str_len);
+	uint32_t shard_ind = get_shard_ind(hash);
+	shard_t *shard = &shards[shard_ind];
+
+	std::shared_lock<std::shared_mutex> lock(shard->lock);
+	uint32_t ind = find_in_shard(shard, str, str_len, hash);
+	if(ind == USTRING_INTERN_INVALID_ID){
+		return USTRING_INTERN_INVALID_ID;
+	}
+	return (shard_ind << INTERN_SHARD_BITS) | ind;
+}
+
+bool ustring_intern_table::get(uint32_t id, ustring &str){
+	uint32_t shard_ind = id >> INTERN_SHARD_BITS;
+	uint32_t ind = id & ((1UL << INTERN_SHARD_BITS) - 1);
+	if(shard_ind >= USTRING_INTERN_SHARDS){
+		return false;
+	}
+	shard_t *shard = &shards[shard_ind];
+
+	std::shared_lock<std::shared_mutex> lock(shard->lock);
+	if(ind >= shard->strings.size()){
+		return false;
+	}
+	return str.assign(shard->strings.at(ind));//memory is reserved before shard string is read
+}
+
+uint32_t ustring_intern_table::size(){
+	uint32_t res = 0;
+	for(uint32_t i = 0; i < USTRING_INTERN_SHARDS; i++){
+		std::shared_lock<std::shared_mutex> lock(shards[i].lock);
+		res += shards[i].strings.size();
+	}
+	return res;
+}
+
+#endif // USTRING_USE_THREADS && !USE_SINGLE_HEAP_MEMORY
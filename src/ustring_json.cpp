@@ -0,0 +1,228 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <string.h>
+#include "ustring_json.h"
+
+#ifdef USTRING_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+static const char hex_digits[] = "0123456789abcdef";
+
+static inline bool needs_escape(uint8_t ch){
+	return (ch < 0x20) || (ch == '"') || (ch == '\\');
+}
+
+static inline ustr_size_t escape_size(uint8_t ch){
+	if((ch == '"') || (ch == '\\') || (ch == '\b') || (ch == '\f') || (ch == '\n') || (ch == '\r') || (ch == '\t')){
+		return 2;
+	}
+	return (ch < 0x20) ? 6 : 1;
+}
+
+#ifdef USTRING_USE_SSE2
+/* Bit mask of symbols which need escaping in 16 symbols */
+static inline uint32_t escape_mask(const char *src){
+	__m128i in = _mm_loadu_si128((const __m128i*)src);
+	__m128i quote = _mm_cmpeq_epi8(in, _mm_set1_epi8('"'));
+	__m128i backslash = _mm_cmpeq_epi8(in, _mm_set1_epi8('\\'));
+	__m128i control = _mm_cmpeq_epi8(_mm_min_epu8(in, _mm_set1_epi8(0x1F)), in);
+	return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quote, backslash), control));
+}
+
+static inline uint32_t backslash_mask(const char *src){
+	__m128i in = _mm_loadu_si128((const __m128i*)src);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(in, _mm_set1_epi8('\\')));
+}
+#endif
+
+uint64_t ustring_json_escaped_size(const char *src, ustr_size_t src_len){
+	uint64_t size = 0;
+	ustr_size_t i = 0;
+#ifdef USTRING_USE_SSE2
+	for(; src_len - i >= 16; i += 16){
+		if(escape_mask(src + i) == 0){
+			size += 16;
+			continue;
+		}
+		for(uint32_t j = 0; j < 16; j++){
+			size += escape_size(src[i + j]);
+		}
+	}
+#endif
+	for(; i < src_len; i++){
+		size += escape_size(src[i]);
+	}
+	return size;
+}
+
+static inline char* escape_char(char *dst, uint8_t ch){
+	*dst++ = '\\';
+	switch(ch){
+		case '"':	*dst++ = '"';	break;
+		case '\\':	*dst++ = '\\';	break;
+		case '\b':	*dst++ = 'b';	break;
+		case '\f':	*dst++ = 'f';	break;
+		case '\n':	*dst++ = 'n';	break;
+		case '\r':	*dst++ = 'r';	break;
+		case '\t':	*dst++ = 't';	break;
+		default:
+			*dst++ = 'u';
+			*dst++ = '0';
+			*dst++ = '0';
+			*dst++ = hex_digits[ch >> 4];
+			*dst++ = hex_digits[ch & 0x0F];
+			break;
+	}
+	return dst;
+}
+
+void ustring_json_escape(char *dst, const char *src, ustr_size_t src_len){
+	ustr_size_t i = 0;
+#ifdef USTRING_USE_SSE2
+	while(src_len - i >= 16){
+		uint32_t mask = escape_mask(src + i);
+		if(mask == 0){
+			memcpy(dst, src + i, 16);
+			dst += 16;
+			i += 16;
+			continue;
+		}
+		uint32_t clean = __builtin_ctz(mask);
+		memcpy(dst, src + i, clean);
+		dst = escape_char(dst + clean, src[i + clean]);
+		i += clean + 1;
+	}
+#endif
+	for(; i < src_len; i++){
+		if(needs_escape(src[i])){
+			dst = escape_char(dst, src[i]);
+		}
+		else{
+			*dst++ = src[i];
+		}
+	}
+}
+
+static bool read_hex4(const char *src, uint32_t *val){
+	*val = 0;
+	for(uint32_t i = 0; i < 4; i++){
+		char ch = src[i];
+		uint32_t nibble;
+		if((ch >= '0') && (ch <= '9')){
+			nibble = ch - '0';
+		}
+		else if(((ch | 0x20) >= 'a') && ((ch | 0x20) <= 'f')){
+			nibble = (ch | 0x20) - 'a' + 10;
+		}
+		else{
+			return false;
+		}
+		*val = (*val << 4) | nibble;
+	}
+	return true;
+}
+
+static char* put_utf8(char *dst, uint32_t code){
+	if(code < 0x80){
+		*dst++ = code;
+	}
+	else if(code < 0x800){
+		*dst++ = 0xC0 | (code >> 6);
+		*dst++ = 0x80 | (code & 0x3F);
+	}
+	else if(code < 0x10000){
+		*dst++ = 0xE0 | (code >> 12);
+		*dst++ = 0x80 | ((code >> 6) & 0x3F);
+		*dst++ = 0x80 | (code & 0x3F);
+	}
+	else{
+		*dst++ = 0xF0 | (code >> 18);
+		*dst++ = 0x80 | ((code >> 12) & 0x3F);
+		*dst++ = 0x80 | ((code >> 6) & 0x3F);
+		*dst++ = 0x80 | (code & 0x3F);
+	}
+	return dst;
+}
+
+ustr_size_t ustring_json_unescape(char *dst, const char *src, ustr_size_t src_len){
+	char *start = dst;
+	ustr_size_t i = 0;
+	while(i < src_len){
+		/* Copy clean run up to the next backslash */
+		ustr_size_t run = i;
+#ifdef USTRING_USE_SSE2
+		uint32_t mask = 0;
+		while((src_len - run >= 16) && ((mask = backslash_mask(src + run)) == 0)){
+			run += 16;
+		}
+		if(mask != 0){
+			run += __builtin_ctz(mask);
+		}
+		else
+#endif
+		{
+			while((run < src_len) && (src[run] != '\\')){
+				run++;
+			}
+		}
+		memcpy(dst, src + i, run - i);
+		dst += run - i;
+		i = run;
+		if(i >= src_len){
+			break;
+		}
+
+		if(src_len - i < 2){
+			return ustring::npos;
+		}
+		char ch = src[i + 1];
+		i += 2;
+		switch(ch){
+			case '"':	*dst++ = '"';	continue;
+			case '\\':	*dst++ = '\\';	continue;
+			case '/':	*dst++ = '/';	continue;
+			case 'b':	*dst++ = '\b';	continue;
+			case 'f':	*dst++ = '\f';	continue;
+			case 'n':	*dst++ = '\n';	continue;
+			case 'r':	*dst++ = '\r';	continue;
+			case 't':	*dst++ = '\t';	continue;
+			case 'u':	break;
+			default:	return ustring::npos;
+		}
+
+		uint32_t code;
+		if((src_len - i < 4) || (read_hex4(src + i, &code) != true)){
+			return ustring::npos;
+		}
+		i += 4;
+		if((code >= 0xDC00) && (code <= 0xDFFF)){
+			return ustring::npos;//low surrogate without high one
+		}
+		if((code >= 0xD800) && (code <= 0xDBFF)){
+			uint32_t low;
+			if((src_len - i < 6) || (src[i] != '\\') || (src[i + 1] != 'u') || (read_hex4(src + i + 2, &low) != true) ||
+					(low < 0xDC00) || (low > 0xDFFF)){
+				return ustring::npos;
+			}
+			i += 6;
+			code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+		}
+		dst = put_utf8(dst, code);//UTF-8 is never longer than escape sequence
+	}
+	return dst - start;
+}
@@ -0,0 +1,548 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "ustring_json_reader.h"
+#include "ustring_budget.h"
+
+#ifdef USTRING_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#define NO_KEY							UINT32_MAX
+#define MAX_NUMBER_LEN					64
+#define MIN_INDEX_CAPACITY				16
+#define MAX_JSON_DEPTH					1024//multiple of 64
+
+/* Fills bit masks of quotes, backslashes and structural symbols for 16 symbols */
+static inline void classify(const char *block, uint32_t *quotes, uint32_t *backslashes, uint32_t *structural){
+#ifdef USTRING_USE_SSE2
+	__m128i in = _mm_loadu_si128((const __m128i*)block);
+	*quotes = _mm_movemask_epi8(_mm_cmpeq_epi8(in, _mm_set1_epi8('"')));
+	*backslashes = _mm_movemask_epi8(_mm_cmpeq_epi8(in, _mm_set1_epi8('\\')));
+	__m128i brackets = _mm_or_si128(_mm_cmpeq_epi8(in, _mm_set1_epi8('[')), _mm_cmpeq_epi8(in, _mm_set1_epi8(']')));
+	brackets = _mm_or_si128(brackets, _mm_cmpeq_epi8(in, _mm_set1_epi8('{')));
+	brackets = _mm_or_si128(brackets, _mm_cmpeq_epi8(in, _mm_set1_epi8('}')));
+	__m128i colons = _mm_cmpeq_epi8(in, _mm_set1_epi8(':'));
+	__m128i commas = _mm_cmpeq_epi8(in, _mm_set1_epi8(','));
+	*structural = _mm_movemask_epi8(_mm_or_si128(brackets, _mm_or_si128(colons, commas)));
+#else
+	*quotes = 0;
+	*backslashes = 0;
+	*structural = 0;
+	for(uint32_t i = 0; i < 16; i++){
+		char ch = block[i];
+		*quotes |= (uint32_t)(ch == '"') << i;
+		*backslashes |= (uint32_t)(ch == '\\') << i;
+		*structural |= (uint32_t)((ch == '[') || (ch == ']') || (ch == '{') || (ch == '}') || (ch == ':') || (ch == ',')) << i;
+	}
+#endif
+}
+
+/* Every bit becomes xor of all lower bits and itself, so bits between opening and closing quotes are set */
+static inline uint32_t prefix_xor(uint32_t mask){
+	mask ^= mask << 1;
+	mask ^= mask << 2;
+	mask ^= mask << 4;
+	mask ^= mask << 8;
+	return mask & 0xFFFF;
+}
+
+static inline bool is_space(char ch){
+	return (ch == ' ') || (ch == '\t') || (ch == '\n') || (ch == '\r');
+}
+
+ustring_json_reader::ustring_json_reader(const ustring &json) : src(json){
+#ifndef USE_SINGLE_HEAP_MEMORY
+	index.assign_mem_pointer(json.get_mem_pointer());
+#endif
+	domain = json.get_tag();
+}
+
+#ifndef USE_SINGLE_HEAP_MEMORY
+ustring_json_reader::ustring_json_reader(const ustring &json, heap_t *index_heap) : src(json){
+	index.assign_mem_pointer(index_heap);
+	domain = json.get_tag();
+}
+#endif
+
+ustring_json_reader::~ustring_json_reader(){
+	ustring_budget_charge(domain, charged_bytes, 0);
+}
+
+/* Grows index by 1.5 times but not above the number of symbols in source, memory is charged to the budget
+ * domain before it is reserved. Reserve may move the source string if index lives in its heap. */
+bool ustring_json_reader::grow_index(){
+	uint64_t limit = (uint64_t)src.size() + 1;//every symbol is structural + end of document
+	uint64_t capacity = index.capacity();
+	uint64_t new_capacity = (capacity < MIN_INDEX_CAPACITY) ? MIN_INDEX_CAPACITY : capacity + capacity / 2;
+	if(new_capacity < limit / 8){
+		new_capacity = limit / 8;//typical density of structural symbols
+	}
+	if(new_capacity > limit){
+		new_capacity = limit;
+	}
+	uint64_t bytes = new_capacity * sizeof(ustr_size_t);
+	if((new_capacity <= capacity) || (new_capacity > UINT32_MAX) || (bytes > UINT32_MAX)){
+		return false;
+	}
+	if(ustring_budget_try_charge(domain, charged_bytes, (uint32_t)bytes) != true){
+		return false;
+	}
+	bool res = index.reserve((uint32_t)new_capacity);
+	uint32_t new_bytes = index.capacity() * sizeof(ustr_size_t);
+	ustring_budget_charge(domain, (uint32_t)bytes, new_bytes);
+	charged_bytes = new_bytes;
+	return res;
+}
+
+bool ustring_json_reader::push_entry(ustr_size_t pos){
+	if((index.size() == index.capacity()) && (grow_index() != true)){
+		return false;
+	}
+	return index.push_back(pos);
+}
+
+/* Checks that structural symbols follow JSON grammar, content of scalars is not checked here, they are
+ * parsed when they are requested. Type of every open container is kept in a bit stack. */
+class json_grammar
+{
+private:
+	enum{
+		EXPECT_KEY,
+		EXPECT_KEY_OR_END,
+		EXPECT_COLON,
+		EXPECT_VALUE,
+		EXPECT_VALUE_OR_END,
+		EXPECT_NEXT
+	} state = EXPECT_VALUE;
+	uint64_t objects[MAX_JSON_DEPTH / 64] = {};
+	uint32_t depth = 0;
+	bool in_string = false;
+	bool string_is_key = false;
+	ustr_size_t gap = 0;//first symbol after previous structural symbol
+
+	bool in_object() const{
+		return (depth > 0) && ((objects[(depth - 1) / 64] >> ((depth - 1) % 64)) & 1);
+	}
+
+	bool expects_value() const{
+		return (state == EXPECT_VALUE) || (state == EXPECT_VALUE_OR_END);
+	}
+
+	bool open(bool object){
+		if(!expects_value() || (depth == MAX_JSON_DEPTH)){
+			return false;
+		}
+		uint64_t bit = 1ULL << (depth % 64);
+		objects[depth / 64] = object ? (objects[depth / 64] | bit) : (objects[depth / 64] & ~bit);
+		depth++;
+		state = object ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END;
+		return true;
+	}
+
+	bool close(bool object){
+		if((depth == 0) || (in_object() != object)){
+			return false;
+		}
+		if((state != EXPECT_NEXT) && (state != (object ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END))){
+			return false;
+		}
+		depth--;
+		state = EXPECT_NEXT;
+		return true;
+	}
+
+	/* Anything except spaces between two structural symbols is a number or a literal, it must be one word */
+	bool scalar(const char *data, ustr_size_t pos){
+		ustr_size_t start = gap;
+		while((start < pos) && is_space(data[start])){
+			start++;
+		}
+		if(start == pos){
+			return true;
+		}
+		ustr_size_t end = start;
+		while((end < pos) && !is_space(data[end])){
+			end++;
+		}
+		while((end < pos) && is_space(data[end])){
+			end++;
+		}
+		if((end != pos) || !expects_value()){
+			return false;
+		}
+		state = EXPECT_NEXT;
+		return true;
+	}
+
+public:
+	bool symbol(const char *data, ustr_size_t pos){
+		char ch = data[pos];
+		if(in_string){//only closing quote is reported inside of string
+			in_string = false;
+			state = string_is_key ? EXPECT_COLON : EXPECT_NEXT;
+			gap = pos + 1;
+			return true;
+		}
+		if(scalar(data, pos) != true){
+			return false;
+		}
+		gap = pos + 1;
+		switch(ch){
+			case '{':	return open(true);
+			case '[':	return open(false);
+			case '}':	return close(true);
+			case ']':	return close(false);
+			case ':':
+				if(state != EXPECT_COLON){
+					return false;
+				}
+				state = EXPECT_VALUE;
+				return true;
+			case ',':
+				if((state != EXPECT_NEXT) || (depth == 0)){
+					return false;
+				}
+				state = in_object() ? EXPECT_KEY : EXPECT_VALUE;
+				return true;
+			default://opening quote
+				string_is_key = (state == EXPECT_KEY) || (state == EXPECT_KEY_OR_END);
+				if(!string_is_key && !expects_value()){
+					return false;
+				}
+				in_string = true;
+				return true;
+		}
+	}
+
+	bool finish(const char *data, ustr_size_t len){
+		return (scalar(data, len) == true) && (depth == 0) && !in_string;
+	}
+};
+
+bool ustring_json_reader::build_index(){
+	ustr_size_t len = src.size();
+	bool in_string = false;
+	bool escape = false;
+	json_grammar grammar;
+
+	for(ustr_size_t base = 0; base < len; base += 16){
+		const char *data = src.data();//index growth may move source
+		uint32_t quotes, backslashes, structural;
+		if(len - base >= 16){
+			classify(data + base, &quotes, &backslashes, &structural);
+		}
+		else{
+			char block[16];
+			memset(block, ' ', sizeof(block));
+			memcpy(block, data + base, len - base);
+			classify(block, &quotes, &backslashes, &structural);
+		}
+
+		/* Symbols after odd number of backslashes are escaped, this is rare so it's done bit by bit */
+		if((backslashes != 0) || escape){
+			uint32_t escaped = 0;
+			for(uint32_t i = 0; i < 16; i++){
+				if(escape){
+					escaped |= 1UL << i;
+					escape = false;
+				}
+				else if(backslashes & (1UL << i)){
+					escape = true;
+				}
+			}
+			quotes &= ~escaped;
+		}
+
+		uint32_t inside = prefix_xor(quotes) ^ (in_string ? 0xFFFF : 0);
+		in_string = (inside & 0x8000) != 0;
+		uint32_t mask = (structural & ~inside) | quotes;
+		while(mask != 0){
+			ustr_size_t pos = base + __builtin_ctz(mask);
+			mask &= mask - 1;
+			if((grammar.symbol(data, pos) != true) || (push_entry(pos) != true)){
+				return false;
+			}
+			data = src.data();
+		}
+	}
+	return grammar.finish(src.data(), len);
+}
+
+/* Index is built in one pass, it grows geometrically and every growth is checked against the budget */
+bool ustring_json_reader::parse(){
+	index.clear();
+	if((build_index() != true) || (push_entry(src.size()) != true)){//+ end of document
+		index.clear();
+		return false;
+	}
+	return true;
+}
+
+uint32_t ustring_json_reader::index_size() const{
+	return index.size();
+}
+
+char ustring_json_reader::symbol(ustr_size_t pos) const{
+	return (pos < src.size()) ? src.data()[pos] : '\0';
+}
+
+ustr_size_t ustring_json_reader::entry(uint32_t ind){
+	return (ind < index.size()) ? index.at(ind) : src.size();
+}
+
+ustr_size_t ustring_json_reader::skip_spaces(ustr_size_t pos) const{
+	while((pos < src.size()) && is_space(src.data()[pos])){
+		pos++;
+	}
+	return pos;
+}
+
+ustring_json_value ustring_json_reader::value_at(ustr_size_t pos, uint32_t ind, uint32_t key_ind){
+	ustring_json_value value;
+	pos = skip_spaces(pos);
+	if(pos < src.size()){
+		value.reader = this;
+		value.pos = pos;
+		value.ind = ind;
+		value.key_ind = key_ind;
+	}
+	return value;
+}
+
+ustring_json_value ustring_json_reader::root(){
+	if(index.size() == 0){
+		return ustring_json_value();//not parsed
+	}
+	return value_at(0, 0, NO_KEY);
+}
+
+bool ustring_json_value::valid() const{
+	return type() != USTRING_JSON_INVALID;
+}
+
+ustring_json_type_t ustring_json_value::type() const{
+	if(reader == NULL){
+		return USTRING_JSON_INVALID;
+	}
+	char ch = reader->symbol(pos);
+	switch(ch){
+		case '{':	return USTRING_JSON_OBJECT;
+		case '[':	return USTRING_JSON_ARRAY;
+		case '"':	return USTRING_JSON_STRING;
+		case 't':	return USTRING_JSON_TRUE;
+		case 'f':	return USTRING_JSON_FALSE;
+		case 'n':	return USTRING_JSON_NULL;
+		default:
+			return ((ch == '-') || ((ch >= '0') && (ch <= '9'))) ? USTRING_JSON_NUMBER : USTRING_JSON_INVALID;
+	}
+}
+
+/* Index entry right after the value */
+uint32_t ustring_json_value::end_ind() const{
+	ustring_json_type_t value_type = type();
+	if(value_type == USTRING_JSON_STRING){
+		return ind + 2;
+	}
+	if((value_type != USTRING_JSON_OBJECT) && (value_type != USTRING_JSON_ARRAY)){
+		return ind;
+	}
+	int32_t depth = 0;
+	for(uint32_t i = ind; i < reader->index_size(); i++){
+		char ch = reader->symbol(reader->entry(i));
+		if((ch == '{') || (ch == '[')){
+			depth++;
+		}
+		else if(((ch == '}') || (ch == ']')) && (--depth == 0)){
+			return i + 1;
+		}
+	}
+	return reader->index_size();
+}
+
+ustring_json_value ustring_json_value::first() const{
+	ustring_json_type_t value_type = type();
+	if(value_type == USTRING_JSON_OBJECT){
+		uint32_t key = ind + 1;
+		if((reader->symbol(reader->entry(key)) != '"') || (reader->symbol(reader->entry(key + 2)) != ':')){
+			return ustring_json_value();//empty object
+		}
+		return reader->value_at(reader->entry(key + 2) + 1, key + 3, key);
+	}
+	if(value_type == USTRING_JSON_ARRAY){
+		ustr_size_t first_pos = reader->skip_spaces(pos + 1);
+		if(reader->symbol(first_pos) == ']'){
+			return ustring_json_value();//empty array
+		}
+		return reader->value_at(first_pos, ind + 1, NO_KEY);
+	}
+	return ustring_json_value();
+}
+
+ustring_json_value ustring_json_value::next() const{
+	if(reader == NULL){
+		return ustring_json_value();
+	}
+	uint32_t comma = end_ind();
+	if(reader->symbol(reader->entry(comma)) != ','){
+		return ustring_json_value();//last value
+	}
+	if(key_ind == NO_KEY){
+		return reader->value_at(reader->entry(comma) + 1, comma + 1, NO_KEY);
+	}
+	uint32_t key = comma + 1;
+	if((reader->symbol(reader->entry(key)) != '"') || (reader->symbol(reader->entry(key + 2)) != ':')){
+		return ustring_json_value();
+	}
+	return reader->value_at(reader->entry(key + 2) + 1, key + 3, key);
+}
+
+ustring_json_value ustring_json_value::get(ustring_view key_name) const{
+	if(type() != USTRING_JSON_OBJECT){
+		return ustring_json_value();
+	}
+	for(ustring_json_value member = first(); member.valid(); member = member.next()){
+		ustring_view name = member.key();
+		if((name.size() == key_name.size()) && (memcmp(name.data(), key_name.data(), name.size()) == 0)){
+			return member;
+		}
+	}
+	return ustring_json_value();
+}
+
+ustring_json_value ustring_json_value::at(uint32_t n) const{
+	if(type() != USTRING_JSON_ARRAY){
+		return ustring_json_value();
+	}
+	ustring_json_value item = first();
+	for(uint32_t i = 0; (i < n) && item.valid(); i++){
+		item = item.next();
+	}
+	return item;
+}
+
+uint32_t ustring_json_value::count() const{
+	uint32_t num = 0;
+	for(ustring_json_value item = first(); item.valid(); item = item.next()){
+		num++;
+	}
+	return num;
+}
+
+ustring_view ustring_json_value::key() const{
+	if((reader == NULL) || (key_ind == NO_KEY)){
+		return ustring_view();
+	}
+	ustr_size_t start = reader->entry(key_ind) + 1;
+	return ustring_view(reader->src.data() + start, reader->entry(key_ind + 1) - start);
+}
+
+ustring_view ustring_json_value::raw() const{
+	ustring_json_type_t value_type = type();
+	if(value_type == USTRING_JSON_INVALID){
+		return ustring_view();
+	}
+	const char *data = reader->src.data();
+	if(value_type == USTRING_JSON_STRING){
+		return ustring_view(data + pos + 1, reader->entry(ind + 1) - pos - 1);
+	}
+	if((value_type == USTRING_JSON_OBJECT) || (value_type == USTRING_JSON_ARRAY)){
+		return ustring_view(data + pos, reader->entry(end_ind() - 1) + 1 - pos);
+	}
+	ustr_size_t end = reader->entry(ind);
+	while((end > pos) && is_space(data[end - 1])){
+		end--;
+	}
+	return ustring_view(data + pos, end - pos);
+}
+
+bool ustring_json_value::has_escapes() const{
+	ustring_view str = raw();
+	return (type() == USTRING_JSON_STRING) && (memchr(str.data(), '\\', str.size()) != NULL);
+}
+
+bool ustring_json_value::get_string(ustring &out) const{
+	if(type() != USTRING_JSON_STRING){
+		return false;
+	}
+	/* Reserve first, because allocation may move source if out is in the same heap */
+	if(out.reserve(out.size() + raw().size()) != true){
+		return false;
+	}
+	ustring_view str = raw();
+	if(has_escapes()){
+		return out.append_json_unescaped(str);
+	}
+	return out.append(str.data(), str.size());
+}
+
+bool ustring_json_value::get_int(int64_t *val) const{
+	ustring_view str = raw();
+	if((type() != USTRING_JSON_NUMBER) || (str.size() == 0)){
+		return false;
+	}
+	bool negative = (str[0] == '-');
+	uint64_t res = 0;
+	ustr_size_t i = negative ? 1 : 0;
+	if(i == str.size()){
+		return false;
+	}
+	for(; i < str.size(); i++){
+		if((str[i] < '0') || (str[i] > '9') || (res > (UINT64_MAX - 9) / 10)){
+			return false;//not integer or too big
+		}
+		res = res * 10 + (str[i] - '0');
+	}
+	if(res > (negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX)){
+		return false;
+	}
+	*val = negative ? (int64_t)(0 - res) : (int64_t)res;
+	return true;
+}
+
+bool ustring_json_value::get_double(double *val) const{
+	ustring_view str = raw();
+	if((type() != USTRING_JSON_NUMBER) || (str.size() >= MAX_NUMBER_LEN)){
+		return false;
+	}
+	char number[MAX_NUMBER_LEN];//source is not null terminated
+	memcpy(number, str.data(), str.size());
+	number[str.size()] = '\0';
+	char *end;
+	*val = strtod(number, &end);
+	return end == number + str.size();
+}
+
+bool ustring_json_value::get_bool(bool *val) const{
+	ustring_view str = raw();
+	ustring_json_type_t value_type = type();
+	if((value_type == USTRING_JSON_TRUE) && (str.size() == 4) && (memcmp(str.data(), "true", 4) == 0)){
+		*val = true;
+		return true;
+	}
+	if((value_type == USTRING_JSON_FALSE) && (str.size() == 5) && (memcmp(str.data(), "false", 5) == 0)){
+		*val = false;
+		return true;
+	}
+	return false;
+}
+
+bool ustring_json_value::is_null() const{
+	ustring_view str = raw();
+	return (type() == USTRING_JSON_NULL) && (str.size() == 4) && (memcmp(str.data(), "null", 4) == 0);
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "ustring_parallel.h"
+#include "ustring_executor.h"
+
+#ifdef USTRING_USE_THREADS
+
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+typedef struct{
+	const char *str;
+	ustr_size_t str_len;
+	ustr_size_t chunk_size;
+} chunks_info_t;
+
+static uint32_t get_threads_num(uint32_t threads, ustring_executor *executor){
+	if(executor != NULL){
+		return executor->workers_num() + 1;//calling thread works too
+	}
+	if(threads == 0){
+		threads = std::thread::hardware_concurrency();
+	}
+	return (threads == 0) ? 1 : threads;
+}
+
+static void fill_chunks_info(chunks_info_t *info, const char *str, ustr_size_t str_len, uint32_t threads, uint32_t *chunks_num){
+	/* Several chunks per worker, so fast workers can take the load from slow ones */
+	uint64_t chunk_size = str_len / (threads * 4);
+	if(chunk_size < USTRING_PARALLEL_MIN_CHUNK){
+		chunk_size = USTRING_PARALLEL_MIN_CHUNK;
+	}
+	if(chunk_size > str_len){
+		chunk_size = str_len;
+	}
+	info->str = str;
+	info->str_len = str_len;
+	info->chunk_size = chunk_size;
+	*chunks_num = str_len / chunk_size + (str_len % chunk_size != 0);//doesn't overflow near max of ustr_size_t
+}
+
+static ustr_size_t chunk_start(const chunks_info_t *info, uint32_t chunk_ind){
+	return (ustr_size_t)((uint64_t)chunk_ind * info->chunk_size);
+}
+
+static ustr_size_t chunk_end(const chunks_info_t *info, ustr_size_t start){
+	return (info->str_len - start > info->chunk_size) ? start + info->chunk_size : info->str_len;
+}
+
+static void run_chunks(uint32_t chunks_num, uint32_t threads, ustring_executor *executor, ustring_for_fn_t fn, void *ctx){
+	if(executor != NULL){
+		executor->parallel_for(chunks_num, fn, ctx);
+		return;
+	}
+
+	std::atomic<uint32_t> next_chunk(0);
+	auto worker = [&](){
+		uint32_t ind;
+		while((ind = next_chunk.fetch_add(1, std::memory_order_relaxed)) < chunks_num){
+			fn(ind, ctx);
+		}
+	};
+
+	if(threads > chunks_num){
+		threads = chunks_num;
+	}
+	std::vector<std::thread> workers;
+	for(uint32_t i = 1; i < threads; i++){
+		workers.emplace_back(worker);
+	}
+	worker();//calling thread works too
+	for(uint32_t i = 0; i < workers.size(); i++){
+		workers[i].join();
+	}
+}
+
+typedef struct{
+	chunks_info_t info;
+	const char *pattern;
+	ustr_size_t pattern_len;
+	std::atomic<ustr_size_t> result;
+} find_ctx_t;
+
+static void find_chunk(uint32_t chunk_ind, void *ctx){
+	find_ctx_t *c = (find_ctx_t*)ctx;
+	ustr_size_t start = chunk_start(&c->info, chunk_ind);
+	if(start >= c->result.load(std::memory_order_relaxed)){
+		return;//match was already found in previous chunk
+	}
+	ustr_size_t end = chunk_end(&c->info, start);//match should begin before the end of chunk
+	if(end > c->info.str_len - c->pattern_len + 1){
+		end = c->info.str_len - c->pattern_len + 1;
+	}
+
+	const char *str = c->info.str;
+	for(ustr_size_t i = start; i < end; i++){
+		const char *cur = (const char*)memchr(str + i, c->pattern[0], end - i);
+		if(cur == NULL){
+			return;
+		}
+		i = cur - str;
+		if(memcmp(cur, c->pattern, c->pattern_len) == 0){
+			ustr_size_t prev = c->result.load(std::memory_order_relaxed);
+			while((i < prev) && !c->result.compare_exchange_weak(prev, i, std::memory_order_relaxed)){
+			}
+			return;
+		}
+	}
+}
+
+static ustr_size_t find_impl(const ustring &str, const char *pattern, uint32_t threads, ustring_executor *executor){
+	find_ctx_t ctx;
+	ctx.pattern = pattern;
+	ctx.pattern_len = strlen(pattern);
+	ctx.result.store(ustring::npos);
+	if(ctx.pattern_len > str.size()){
+		return ustring::npos;
+	}
+	if(ctx.pattern_len == 0){
+		return 0;
+	}
+
+	threads = get_threads_num(threads, executor);
+	uint32_t chunks_num;
+	fill_chunks_info(&ctx.info, str.data(), str.size(), threads, &chunks_num);
+	run_chunks(chunks_num, threads, executor, find_chunk, &ctx);
+	return ctx.result.load();
+}
+
+typedef struct{
+	chunks_info_t info;
+	char ch;
+	std::atomic<ustr_size_t> result;
+} count_ctx_t;
+
+static void count_chunk(uint32_t chunk_ind, void *ctx){
+	count_ctx_t *c = (count_ctx_t*)ctx;
+	ustr_size_t start = chunk_start(&c->info, chunk_ind);
+	ustr_size_t end = chunk_end(&c->info, start);
+
+	ustr_size_t res = 0;
+	for(ustr_size_t i = start; i < end; i++){
+		res += (c->info.str[i] == c->ch);
+	}
+	c->result.fetch_add(res, std::memory_order_relaxed);
+}
+
+static ustr_size_t count_impl(const ustring &str, char ch, uint32_t threads, ustring_executor *executor){
+	count_ctx_t ctx;
+	ctx.ch = ch;
+	ctx.result.store(0);
+	if(str.size() == 0){
+		return 0;
+	}
+
+	threads = get_threads_num(threads, executor);
+	uint32_t chunks_num;
+	fill_chunks_info(&ctx.info, str.data(), str.size(), threads, &chunks_num);
+	run_chunks(chunks_num, threads, executor, count_chunk, &ctx);
+	return ctx.result.load();
+}
+
+typedef struct{
+	chunks_info_t info;
+	char (*fn)(char);
+} transform_ctx_t;
+
+static void transform_chunk(uint32_t chunk_ind, void *ctx){
+	transform_ctx_t *c = (transform_ctx_t*)ctx;
+	ustr_size_t start = chunk_start(&c->info, chunk_ind);
+	ustr_size_t end = chunk_end(&c->info, start);
+
+	char *str = const_cast<char*>(c->info.str);
+	for(ustr_size_t i = start; i < end; i++){
+		str[i] = c->fn(str[i]);
+	}
+}
+
+static void transform_impl(ustring &str, char (*fn)(char), uint32_t threads, ustring_executor *executor){
+	if(str.size() == 0){
+		return;
+	}
+	transform_ctx_t ctx;
+	ctx.fn = fn;
+
+	threads = get_threads_num(threads, executor);
+	uint32_t chunks_num;
+	fill_chunks_info(&ctx.info, str.data(), str.size(), threads, &chunks_num);
+	run_chunks(chunks_num, threads, executor, transform_chunk, &ctx);
+}
+
+static char char_to_lower(char ch){
+	if((ch >= 'A') && (ch <= 'Z')){
+		return ch + ('a' - 'A');
+	}
+	return ch;
+}
+
+ustr_size_t parallel_find(const ustring &str, const char *pattern, uint32_t threads){
+	return find_impl(str, pattern, threads, NULL);
+}
+
+ustr_size_t parallel_count(const ustring &str, char ch, uint32_t threads){
+	return count_impl(str, ch, threads, NULL);
+}
+
+void parallel_transform(ustring &str, char (*fn)(char), uint32_t threads){
+	transform_impl(str, fn, threads, NULL);
+}
+
+void parallel_to_lower(ustring &str, uint32_t threads){
+	transform_impl(str, char_to_lower, threads, NULL);
+}
+
+ustr_size_t parallel_find(const ustring &str, const char *pattern, ustring_executor &executor){
+	return find_impl(str, pattern, 0, &executor);
+}
+
+ustr_size_t parallel_count(const ustring &str, char ch, ustring_executor &executor){
+	return count_impl(str, ch, 0, &executor);
+}
+
+void parallel_transform(ustring &str, char (*fn)(char), ustring_executor &executor){
+	transform_impl(str, fn, 0, &executor);
+}
+
+void parallel_to_lower(ustring &str, ustring_executor &executor){
+	transform_impl(str, char_to_lower, 0, &executor);
+}
+
+#endif // USTRING_USE_THREADS
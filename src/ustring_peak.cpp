@@ -0,0 +1,95 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "ustring_peak.h"
+
+#ifdef USTRING_TRACK_PEAK
+
+#include <stdio.h>
+
+#ifdef USTRING_USE_THREADS
+#include <mutex>
+static std::mutex peak_mutex;
+#define PEAK_LOCK()						std::lock_guard<std::mutex> peak_lock(peak_mutex)
+#else
+#define PEAK_LOCK()
+#endif
+
+static ustring_peak_stats_t peak_stats;
+
+static void update_peak(uint32_t bytes, uint32_t blocks){
+	if(bytes > peak_stats.peak_bytes){
+		peak_stats.peak_bytes = bytes;
+	}
+	if(blocks > peak_stats.peak_blocks){
+		peak_stats.peak_blocks = blocks;
+	}
+}
+
+void ustring_peak_record(uint32_t old_capacity, uint32_t new_capacity){
+	PEAK_LOCK();
+	if(new_capacity > 0){
+		/* New block is allocated while old one still exists */
+		update_peak(peak_stats.live_bytes + new_capacity, peak_stats.live_blocks + 1);
+		peak_stats.live_bytes += new_capacity;
+		peak_stats.live_blocks++;
+	}
+	if(old_capacity > 0){
+		peak_stats.live_bytes -= old_capacity;
+		peak_stats.live_blocks--;
+		if(new_capacity > 0){
+			peak_stats.reallocations++;
+		}
+	}
+}
+
+void ustring_peak_reset(){
+	PEAK_LOCK();
+	peak_stats.peak_bytes = peak_stats.live_bytes;
+	peak_stats.peak_blocks = peak_stats.live_blocks;
+	peak_stats.reallocations = 0;
+}
+
+void ustring_peak_get_stats(ustring_peak_stats_t *stats){
+	PEAK_LOCK();
+	*stats = peak_stats;
+}
+
+static uint32_t recommended_heap_size(const ustring_peak_stats_t *stats, uint32_t headroom_percent){
+	uint64_t res = stats->peak_bytes + (uint64_t)stats->peak_blocks * USTRING_PEAK_BLOCK_OVERHEAD;
+	res += (res / 100) * headroom_percent + (res % 100) * headroom_percent / 100;//res * headroom_percent / 100 without overflow
+	return (res > UINT32_MAX) ? UINT32_MAX : (uint32_t)res;
+}
+
+/* Stats are copied under the lock, so the report isn't torn by strings that change meanwhile */
+uint32_t ustring_peak_recommended_heap_size(uint32_t headroom_percent){
+	ustring_peak_stats_t stats;
+	ustring_peak_get_stats(&stats);
+	return recommended_heap_size(&stats, headroom_percent);
+}
+
+void ustring_peak_print_report(uint32_t headroom_percent){
+	ustring_peak_stats_t stats;
+	ustring_peak_get_stats(&stats);
+	printf("ustring memory usage:\n");
+	printf("  live: %lu bytes in %lu blocks\n", (unsigned long)stats.live_bytes, (unsigned long)stats.live_blocks);
+	printf("  peak: %lu bytes in %lu blocks\n", (unsigned long)stats.peak_bytes, (unsigned long)stats.peak_blocks);
+	printf("  reallocations: %lu\n", (unsigned long)stats.reallocations);
+	printf("  recommended SINGLE_HEAP_SIZE (%lu%% headroom): %lu\n", (unsigned long)headroom_percent,
+			(unsigned long)recommended_heap_size(&stats, headroom_percent));
+}
+
+#endif // USTRING_TRACK_PEAK
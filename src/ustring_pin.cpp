@@ -0,0 +1,141 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "ustring_pin.h"
+
+/* Table is shared by threads that own different heaps. Most programs don't pin at all, so growth
+ * checks the number of pinnable heaps without lock first */
+#ifdef USTRING_USE_THREADS
+#include <mutex>
+#include <atomic>
+static std::mutex pin_mutex;
+#define PIN_LOCK()						std::lock_guard<std::mutex> pin_lock(pin_mutex)
+typedef std::atomic<uint32_t> pin_counter_t;
+#else
+#define PIN_LOCK()
+typedef uint32_t pin_counter_t;
+#endif
+
+typedef struct{
+	heap_t *heap;
+	uint32_t pins_num;
+	uint32_t pinned_bytes;
+} pinnable_heap_t;
+
+static pinnable_heap_t pinnable_heaps[USTRING_MAX_PINNED_HEAPS];
+static pin_counter_t pinnable_heaps_num(0);
+
+static pinnable_heap_t* get_pinnable_heap(heap_t *heap){
+	for(uint32_t i = 0; i < pinnable_heaps_num; i++){
+		if(pinnable_heaps[i].heap == heap){
+			return &pinnable_heaps[i];
+		}
+	}
+	return NULL;
+}
+
+bool ustring_heap_allow_pinning(heap_t *heap){
+	PIN_LOCK();
+	if(get_pinnable_heap(heap) != NULL){
+		return true;
+	}
+	if(pinnable_heaps_num >= USTRING_MAX_PINNED_HEAPS){
+		return false;
+	}
+	uint32_t ind = pinnable_heaps_num;
+	pinnable_heaps[ind].heap = heap;
+	pinnable_heaps[ind].pins_num = 0;
+	pinnable_heaps[ind].pinned_bytes = 0;
+	pinnable_heaps_num = ind + 1;
+	return true;
+}
+
+bool ustring_heap_disallow_pinning(heap_t *heap){
+	PIN_LOCK();
+	pinnable_heap_t *info = get_pinnable_heap(heap);
+	if(info == NULL){
+		return true;
+	}
+	if(info->pins_num > 0){
+		return false;
+	}
+	uint32_t last = pinnable_heaps_num - 1;
+	*info = pinnable_heaps[last];
+	pinnable_heaps_num = last;
+	return true;
+}
+
+ustring_pin::ustring_pin(ustring &str){
+	heap = str.get_mem_pointer();
+	ptr = str.data();
+	len = str.size();
+	bytes = str.capacity();
+	active = false;
+
+	PIN_LOCK();
+	pinnable_heap_t *info = get_pinnable_heap(heap);
+	if(info == NULL){
+		return;//heap doesn't allow pinning
+	}
+	info->pins_num++;
+	info->pinned_bytes += bytes;
+	active = true;
+}
+
+ustring_pin::~ustring_pin(){
+	if(active != true){
+		return;
+	}
+	PIN_LOCK();
+	pinnable_heap_t *info = get_pinnable_heap(heap);
+	if(info != NULL){
+		info->pins_num--;
+		info->pinned_bytes -= bytes;
+	}
+}
+
+bool ustring_pin::pinned() const{
+	return active;
+}
+
+char* ustring_pin::data() const{
+	return ptr;
+}
+
+ustr_size_t ustring_pin::size() const{
+	return len;
+}
+
+bool ustring_heap_is_pinned(heap_t *heap){
+	if(pinnable_heaps_num == 0){
+		return false;
+	}
+	PIN_LOCK();
+	pinnable_heap_t *info = get_pinnable_heap(heap);
+	return (info != NULL) && (info->pins_num > 0);
+}
+
+uint32_t ustring_pins_num(heap_t *heap){
+	PIN_LOCK();
+	pinnable_heap_t *info = get_pinnable_heap(heap);
+	return (info != NULL) ? info->pins_num : 0;
+}
+
+uint32_t ustring_pinned_bytes(heap_t *heap){
+	PIN_LOCK();
+	pinnable_heap_t *info = get_pinnable_heap(heap);
+	return (info != NULL) ? info->pinned_bytes : 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "ustring_placement.h"
+
+#ifndef USE_SINGLE_HEAP_MEMORY
+
+#ifdef USTRING_USE_THREADS
+#include <mutex>
+static std::mutex placement_mutex;
+#define PLACEMENT_LOCK()				std::lock_guard<std::mutex> placement_lock(placement_mutex)
+#else
+#define PLACEMENT_LOCK()
+#endif
+
+typedef struct{
+	heap_t *primary;
+	heap_t *secondary;
+} spill_heap_t;
+
+static ustring_placement_fn_t placement_policy = NULL;
+static const ustring_size_class_t *size_classes = NULL;
+static uint32_t size_classes_num = 0;
+static const ustring_tag_heap_t *tag_heaps = NULL;
+static uint32_t tag_heaps_num = 0;
+static heap_t * const *fill_heaps = NULL;
+static uint32_t fill_heaps_num = 0;
+static spill_heap_t spill_heaps[USTRING_MAX_SPILL_HEAPS];
+static uint32_t spill_heaps_num = 0;
+
+void ustring_set_placement_policy(ustring_placement_fn_t policy){
+	PLACEMENT_LOCK();
+	placement_policy = policy;
+}
+
+/* Policy is called without the lock, built-in policies take it themselves */
+heap_t* ustring_place(ustr_size_t size, uint8_t tag, heap_t *current){
+	ustring_placement_fn_t policy;
+	{
+		PLACEMENT_LOCK();
+		policy = placement_policy;
+	}
+	if(policy == NULL){
+		return current;
+	}
+	heap_t *res = policy(size, tag, current);
+	return (res != NULL) ? res : current;
+}
+
+void ustring_set_size_classes(const ustring_size_class_t *classes, uint32_t classes_num){
+	PLACEMENT_LOCK();
+	size_classes = classes;
+	size_classes_num = classes_num;
+}
+
+heap_t* ustring_size_class_policy(ustr_size_t size, uint8_t tag, heap_t *current){
+	(void)tag;
+	(void)current;
+	PLACEMENT_LOCK();
+	if(size_classes_num == 0){
+		return NULL;
+	}
+	for(uint32_t i = 0; i < size_classes_num; i++){
+		if(size <= size_classes[i].max_size){
+			return size_classes[i].heap;
+		}
+	}
+	return size_classes[size_classes_num - 1].heap;
+}
+
+void ustring_set_tag_heaps(const ustring_tag_heap_t *tag_heaps_arr, uint32_t tag_heaps_arr_num){
+	PLACEMENT_LOCK();
+	tag_heaps = tag_heaps_arr;
+	tag_heaps_num = tag_heaps_arr_num;
+}
+
+heap_t* ustring_tag_policy(ustr_size_t size, uint8_t tag, heap_t *current){
+	(void)size;
+	(void)current;
+	PLACEMENT_LOCK();
+	for(uint32_t i = 0; i < tag_heaps_num; i++){
+		if(tag_heaps[i].tag == tag){
+			return tag_heaps[i].heap;
+		}
+	}
+	return NULL;
+}
+
+void ustring_set_fill_heaps(heap_t * const *heaps, uint32_t heaps_num){
+	PLACEMENT_LOCK();
+	fill_heaps = heaps;
+	fill_heaps_num = heaps_num;
+}
+
+/* dalloc keeps allocated blocks packed from the start of the heap, so memory after offset is free */
+heap_t* ustring_fill_level_policy(ustr_size_t size, uint8_t tag, heap_t *current){
+	(void)size;//the least filled heap is used even if string doesn't fit there, then string can spill
+	(void)tag;
+	(void)current;
+	PLACEMENT_LOCK();
+	heap_t *res = NULL;
+	uint32_t res_free = 0;
+	for(uint32_t i = 0; i < fill_heaps_num; i++){
+		heap_t *heap = fill_heaps[i];
+		uint32_t free_size = (heap->offset < heap->total_size) ? heap->total_size - heap->offset : 0;
+		if((res == NULL) || (free_size > res_free)){
+			res = heap;
+			res_free = free_size;
+		}
+	}
+	return res;
+}
+
+bool ustring_set_spill_heap(heap_t *primary, heap_t *secondary){
+	PLACEMENT_LOCK();
+	for(uint32_t i = 0; i < spill_heaps_num; i++){
+		if(spill_heaps[i].primary == primary){
+			spill_heaps[i].secondary = secondary;
+			return true;
+		}
+	}
+	if(spill_heaps_num >= USTRING_MAX_SPILL_HEAPS){
+		return false;
+	}
+	spill_heaps[spill_heaps_num].primary = primary;
+	spill_heaps[spill_heaps_num].secondary = secondary;
+	spill_heaps_num++;
+	return true;
+}
+
+heap_t* ustring_get_spill_heap(heap_t *primary){
+	PLACEMENT_LOCK();
+	for(uint32_t i = 0; i < spill_heaps_num; i++){
+		if(spill_heaps[i].primary == primary){
+			return spill_heaps[i].secondary;
+		}
+	}
+	return NULL;
+}
+
+#endif // USE_SINGLE_HEAP_MEMORY
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "ustring_pressure.h"
+
+/* Strings of different threads (and heaps) share the lists. Callbacks are called without lock,
+ * so they can subscribe, unsubscribe and allocate. Re-entrancy flag is per thread, because
+ * pressure in one thread's heap doesn't prevent relieving it in another thread's heap */
+#ifdef USTRING_USE_THREADS
+#include <mutex>
+static std::mutex pressure_mutex;
+#define PRESSURE_LOCK()					std::lock_guard<std::mutex> pressure_lock(pressure_mutex)
+#define PRESSURE_THREAD_LOCAL			thread_local
+#include <atomic>
+typedef std::atomic<uint32_t> pressure_counter_t;//read without lock by destructors of all strings
+#else
+#define PRESSURE_LOCK()
+#define PRESSURE_THREAD_LOCAL
+typedef uint32_t pressure_counter_t;
+#endif
+
+static ustring *subscribers[USTRING_MAX_PRESSURE_SUBSCRIBERS];
+static pressure_counter_t subscribers_num(0);
+static ustring_pressure_cb_t callbacks[USTRING_MAX_PRESSURE_CALLBACKS];
+static uint32_t callbacks_num = 0;
+static PRESSURE_THREAD_LOCAL bool relieve_in_progress = false;
+static PRESSURE_THREAD_LOCAL bool relieve_suspended = false;
+
+bool ustring_pressure_add_callback(ustring_pressure_cb_t cb){
+	PRESSURE_LOCK();
+	if(callbacks_num >= USTRING_MAX_PRESSURE_CALLBACKS){
+		return false;
+	}
+	callbacks[callbacks_num++] = cb;
+	return true;
+}
+
+void ustring_pressure_remove_callback(ustring_pressure_cb_t cb){
+	PRESSURE_LOCK();
+	for(uint32_t i = 0; i < callbacks_num; i++){
+		if(callbacks[i] == cb){
+			callbacks[i] = callbacks[--callbacks_num];
+			return;
+		}
+	}
+}
+
+bool ustring_pressure_subscribe(ustring *str){
+	PRESSURE_LOCK();
+	for(uint32_t i = 0; i < subscribers_num; i++){
+		if(subscribers[i] == str){
+			return true;
+		}
+	}
+	if(subscribers_num >= USTRING_MAX_PRESSURE_SUBSCRIBERS){
+		return false;
+	}
+	subscribers[subscribers_num++] = str;
+	return true;
+}
+
+void ustring_pressure_unsubscribe(ustring *str){
+	if(subscribers_num == 0){
+		return;//every string calls it in destructor
+	}
+	PRESSURE_LOCK();
+	for(uint32_t i = 0; i < subscribers_num; i++){
+		if(subscribers[i] == str){
+			subscribers[i] = subscribers[--subscribers_num];
+			return;
+		}
+	}
+}
+
+uint32_t ustring_pressure_subscribers_num(){
+	return subscribers_num;
+}
+
+void ustring_pressure_suspend(bool suspend){
+	relieve_suspended = suspend;
+}
+
+uint32_t ustring_relieve_pressure(heap_t *heap, const ustring *requester){
+	if((relieve_in_progress == true) || (relieve_suspended == true)){
+		return 0;//callbacks can allocate memory too
+	}
+	relieve_in_progress = true;
+
+	uint32_t released = 0;
+	ustring_pressure_cb_t heap_callbacks[USTRING_MAX_PRESSURE_CALLBACKS];
+	uint32_t heap_callbacks_num;
+	{
+		/* Lock keeps strings of other threads alive while their heaps are checked, strings of
+		 * this heap belong to this thread, so they can be shrunk here */
+		PRESSURE_LOCK();
+		for(uint32_t i = 0; i < subscribers_num; i++){
+			ustring *str = subscribers[i];
+			if((str == requester) || (str->get_mem_pointer() != heap)){
+				continue;
+			}
+			uint32_t old_capacity = str->capacity();
+			if(old_capacity <= (uint32_t)str->size() + 1){
+				continue;//no spare memory
+			}
+			if(str->shrink_to_fit() == true){
+				released += old_capacity - str->capacity();
+			}
+		}
+		heap_callbacks_num = callbacks_num;
+		memcpy(heap_callbacks, callbacks, callbacks_num * sizeof(ustring_pressure_cb_t));
+	}
+	for(uint32_t i = 0; i < heap_callbacks_num; i++){
+		heap_callbacks[i](heap);
+	}
+
+	relieve_in_progress = false;
+	return released;
+}
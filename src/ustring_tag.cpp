@@ -0,0 +1,117 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <stdint.h>
+#include "ustring_tag.h"
+
+/* Tag is read on every allocation of a string, so readers share the lock */
+#ifdef USTRING_USE_THREADS
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+static std::shared_mutex tag_mutex;
+#define TAG_READ_LOCK()					std::shared_lock<std::shared_mutex> tag_lock(tag_mutex)
+#define TAG_WRITE_LOCK()				std::unique_lock<std::shared_mutex> tag_lock(tag_mutex)
+typedef std::atomic<uint32_t> tag_counter_t;
+#else
+#define TAG_READ_LOCK()
+#define TAG_WRITE_LOCK()
+typedef uint32_t tag_counter_t;
+#endif
+
+#define TAG_SLOTS_NUM					(USTRING_MAX_TAGGED_STRINGS * 2)//open addressing, table is at most half full
+
+typedef struct{
+	const ustring *str;
+	uint8_t tag;
+} tag_slot_t;
+
+static tag_slot_t tag_slots[TAG_SLOTS_NUM];
+static tag_counter_t tagged_strings_num(0);
+
+static inline uint32_t get_first_slot(const ustring *str){
+	uint64_t key = (uint64_t)(uintptr_t)str;
+	return (uint32_t)(((key >> 3) * 0x9E3779B97F4A7C15ULL) >> 32) % TAG_SLOTS_NUM;
+}
+
+/* Returns slot of the string or the first empty slot of its probe sequence */
+static uint32_t find_slot(const ustring *str){
+	uint32_t slot = get_first_slot(str);
+	while((tag_slots[slot].str != NULL) && (tag_slots[slot].str != str)){
+		slot = (slot + 1) % TAG_SLOTS_NUM;
+	}
+	return slot;
+}
+
+/* Linear probing without tombstones, following entries are shifted back to the freed slot */
+static void remove_slot(uint32_t slot){
+	uint32_t next = slot;
+	while(true){
+		next = (next + 1) % TAG_SLOTS_NUM;
+		if(tag_slots[next].str == NULL){
+			break;
+		}
+		uint32_t home = get_first_slot(tag_slots[next].str);
+		bool movable = (slot <= next) ? ((home <= slot) || (home > next)) : ((home <= slot) && (home > next));
+		if(movable){
+			tag_slots[slot] = tag_slots[next];
+			slot = next;
+		}
+	}
+	tag_slots[slot].str = NULL;
+	tag_slots[slot].tag = 0;
+}
+
+bool ustring_tag_set(const ustring *str, uint8_t tag){
+	if((tag == 0) && (tagged_strings_num == 0)){
+		return true;
+	}
+	TAG_WRITE_LOCK();
+	uint32_t slot = find_slot(str);
+	if(tag_slots[slot].str == str){
+		if(tag != 0){
+			tag_slots[slot].tag = tag;
+		}
+		else{
+			remove_slot(slot);
+			tagged_strings_num--;
+		}
+		return true;
+	}
+	if(tag == 0){
+		return true;
+	}
+	if(tagged_strings_num >= USTRING_MAX_TAGGED_STRINGS){
+		return false;
+	}
+	tag_slots[slot].str = str;
+	tag_slots[slot].tag = tag;
+	tagged_strings_num++;
+	return true;
+}
+
+uint8_t ustring_tag_get(const ustring *str){
+	if(tagged_strings_num == 0){
+		return 0;
+	}
+	TAG_READ_LOCK();
+	uint32_t slot = find_slot(str);
+	return (tag_slots[slot].str == str) ? tag_slots[slot].tag : 0;
+}
+
+uint32_t ustring_tagged_strings_num(){
+	return tagged_strings_num;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Scaling benchmark of ustring_intern_table lookups: prints lookup throughput for 1..N threads,
+ * N is the first argument or 32. Every thread looks up all BENCH_KEYS keys in its own order */
+
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include "test.h"
+#include "ustring_intern.h"
+
+#ifndef BENCH_KEYS
+#define BENCH_KEYS						(64UL * 1024UL)
+#endif
+#define BENCH_KEY_SIZE					16
+#define BENCH_SHARD_HEAP_SIZE			(2UL * 1024UL * 1024UL)
+#define BENCH_REPEATS					3
+#define BENCH_MAX_THREADS				64
+
+#if defined(USTRING_USE_THREADS) && !defined(USE_SINGLE_HEAP_MEMORY)
+
+static ustring_intern_table table;
+static char keys[BENCH_KEYS][BENCH_KEY_SIZE];
+
+static void lookup_all(uint32_t first, uint32_t *found){
+	uint32_t res = 0;
+	for(uint32_t i = 0; i < BENCH_KEYS; i++){
+		res += table.find(keys[(first + i * 7919) % BENCH_KEYS]) != USTRING_INTERN_INVALID_ID;
+	}
+	*found = res;
+}
+
+/* Returns millions of lookups per second of all threads */
+static double measure(uint32_t threads_num){
+	double best = 0;
+	for(uint32_t r = 0; r < BENCH_REPEATS; r++){
+		std::thread threads[BENCH_MAX_THREADS];
+		uint32_t found[BENCH_MAX_THREADS];
+		auto start = std::chrono::steady_clock::now();
+		for(uint32_t t = 0; t < threads_num; t++){
+			threads[t] = std::thread(lookup_all, t * (BENCH_KEYS / threads_num), &found[t]);
+		}
+		for(uint32_t t = 0; t < threads_num; t++){
+			threads[t].join();
+			if(found[t] != BENCH_KEYS){
+				abort();
+			}
+		}
+		double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if((best == 0) || (sec < best)){
+			best = sec;
+		}
+	}
+	return (double)BENCH_KEYS * threads_num / best / 1e6;
+}
+
+int main(int argc, char **argv){
+	static heap_t shard_heaps[USTRING_INTERN_SHARDS];
+	heap_t *heaps[USTRING_INTERN_SHARDS];
+	for(uint32_t i = 0; i < USTRING_INTERN_SHARDS; i++){
+		heap_init(&shard_heaps[i], malloc(BENCH_SHARD_HEAP_SIZE), BENCH_SHARD_HEAP_SIZE);
+		heaps[i] = &shard_heaps[i];
+	}
+	if(table.init(heaps) != true){
+		printf("can't init intern table\n");
+		return 1;
+	}
+	for(uint32_t i = 0; i < BENCH_KEYS; i++){
+		snprintf(keys[i], BENCH_KEY_SIZE, "key%lu", (unsigned long)i);
+		if(table.intern(keys[i]) == USTRING_INTERN_INVALID_ID){
+			printf("can't intern %lu keys\n", (unsigned long)BENCH_KEYS);
+			return 1;
+		}
+	}
+
+	uint32_t max_threads = (argc > 1) ? atoi(argv[1]) : 32;
+	if(max_threads > BENCH_MAX_THREADS){
+		max_threads = BENCH_MAX_THREADS;
+	}
+	printf("%lu keys, %u shards, million lookups/s\n", (unsigned long)BENCH_KEYS, (unsigned)USTRING_INTERN_SHARDS);
+	printf("threads   lookups\n");
+	for(uint32_t threads = 1; threads <= max_threads; threads *= 2){
+		printf("%7u  %8.2f\n", threads, measure(threads));
+	}
+	return 0;
+}
+
+#else
+
+int main(){
+	printf("benchmark needs USTRING_USE_THREADS and multi-heap mode\n");
+	return 0;
+}
+
+#endif
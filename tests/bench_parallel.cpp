@@ -0,0 +1,89 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Scaling benchmark of parallel_find/parallel_count/parallel_to_lower: prints throughput for
+ * 1..N threads on BENCH_SIZE string in its own heap, N is the first argument or hardware_concurrency() */
+
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include "test.h"
+#include "ustring_parallel.h"
+
+#ifndef BENCH_SIZE
+#define BENCH_SIZE						(128UL * 1024UL * 1024UL)
+#endif
+#define BENCH_REPEATS					5
+
+#if defined(USTRING_USE_THREADS) && !defined(USE_SINGLE_HEAP_MEMORY)
+
+static double measure(void (*fn)(ustring&, uint32_t), ustring &str, uint32_t threads){
+	double best = 0;
+	for(uint32_t i = 0; i < BENCH_REPEATS; i++){
+		auto start = std::chrono::steady_clock::now();
+		fn(str, threads);
+		double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if((best == 0) || (sec < best)){
+			best = sec;
+		}
+	}
+	return (double)str.size() / best / (1024.0 * 1024.0 * 1024.0);//GB/s
+}
+
+static void run_find(ustring &str, uint32_t threads){
+	if(parallel_find(str, "needle", threads) != ustring::npos){
+		abort();
+	}
+}
+
+static void run_count(ustring &str, uint32_t threads){
+	if(parallel_count(str, 'x', threads) != 0){
+		abort();
+	}
+}
+
+static void run_to_lower(ustring &str, uint32_t threads){
+	parallel_to_lower(str, threads);
+}
+
+int main(int argc, char **argv){
+	static heap_t bench_heap;
+	uint8_t *heap_array = (uint8_t*)malloc(BENCH_SIZE + 1024);
+	heap_init(&bench_heap, (void*)heap_array, BENCH_SIZE + 1024);
+	ustring str(&bench_heap);
+	if(str.resize(BENCH_SIZE, 'a') != true){
+		printf("can't allocate %lu bytes\n", (unsigned long)BENCH_SIZE);
+		return 1;
+	}
+
+	uint32_t max_threads = (argc > 1) ? atoi(argv[1]) : std::thread::hardware_concurrency();
+	printf("%lu MB string, GB/s\n", (unsigned long)(BENCH_SIZE >> 20));
+	printf("threads      find     count  to_lower\n");
+	for(uint32_t threads = 1; threads <= max_threads; threads *= 2){
+		printf("%7u  %8.2f  %8.2f  %8.2f\n", threads, measure(run_find, str, threads),
+				measure(run_count, str, threads), measure(run_to_lower, str, threads));
+	}
+	return 0;
+}
+
+#else
+
+int main(){
+	printf("benchmark needs USTRING_USE_THREADS and multi-heap mode\n");
+	return 0;
+}
+
+#endif
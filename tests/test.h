@@ -0,0 +1,45 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include "ustring.h"
+
+#define TEST_HEAP_SIZE					(4UL * 1024UL * 1024UL)
+
+extern uint32_t test_failures;
+
+#define CHECK(cond)		do{ \
+							if(!(cond)){ \
+								printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+								test_failures++; \
+							} \
+						}while(0)
+
+/* Strings of tests are created in the test heap in multi-heap mode */
+#ifdef USE_SINGLE_HEAP_MEMORY
+#define TEST_STRING(name)				ustring name
+#else
+extern heap_t test_heap;
+#define TEST_STRING(name)				ustring name(&test_heap)
+#endif
+
+void test_init();
+int test_result(const char *name);
+
+#endif // TEST_H
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* The same checks are built with vector kernels and with USTRING_NO_SIMD, both builds are compared
+ * with simple reference implementations, so scalar and vector kernels give the same results */
+
+#include <string.h>
+#include "test.h"
+#include "ustring_json_reader.h"
+
+static uint32_t rand_state = 1;
+
+static uint8_t rand_byte(){
+	rand_state = rand_state * 1103515245 + 12345;
+	return rand_state >> 16;
+}
+
+static void fill_random(uint8_t *buf, uint32_t len){
+	for(uint32_t i = 0; i < len; i++){
+		buf[i] = rand_byte();
+	}
+}
+
+static bool equals(ustring &str, const char *expected, uint32_t expected_len){
+	return (str.size() == expected_len) && (memcmp(str.data(), expected, expected_len) == 0);
+}
+
+static uint32_t ref_base64(char *dst, const uint8_t *src, uint32_t len, bool url_safe){
+	const char *alphabet = url_safe ? "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_" :
+			"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	uint32_t out = 0;
+	for(uint32_t i = 0; i < len; i += 3){
+		uint32_t rest = len - i;
+		uint32_t triple = (src[i] << 16) | ((rest > 1) ? (src[i + 1] << 8) : 0) | ((rest > 2) ? src[i + 2] : 0);
+		dst[out++] = alphabet[(triple >> 18) & 0x3F];
+		dst[out++] = alphabet[(triple >> 12) & 0x3F];
+		if(rest > 1){
+			dst[out++] = alphabet[(triple >> 6) & 0x3F];
+		}
+		else if(!url_safe){
+			dst[out++] = '=';
+		}
+		if(rest > 2){
+			dst[out++] = alphabet[triple & 0x3F];
+		}
+		else if(!url_safe){
+			dst[out++] = '=';
+		}
+	}
+	return out;
+}
+
+static void test_base64(){
+	uint8_t src[300];
+	char expected[400];
+	for(uint32_t len = 0; len < sizeof(src); len++){
+		for(uint32_t url_safe = 0; url_safe < 2; url_safe++){
+			fill_random(src, len);
+			uint32_t expected_len = ref_base64(expected, src, len, url_safe);
+			TEST_STRING(encoded);
+			CHECK(encoded.append_base64(src, len, url_safe));
+			CHECK(equals(encoded, expected, expected_len));
+
+			TEST_STRING(decoded);
+			CHECK(decoded.decode_base64(ustring_view(expected, expected_len), url_safe));
+			CHECK(equals(decoded, (const char*)src, len));
+
+			if(expected_len > 2){
+				expected[rand_byte() % (expected_len - 2)] = '*';
+				TEST_STRING(broken);
+				CHECK(broken.decode_base64(ustring_view(expected, expected_len), url_safe) == false);
+				CHECK(broken.size() == 0);
+			}
+		}
+	}
+	TEST_STRING(text);
+	CHECK(text.decode_base64("aGVsbG8="));
+	CHECK(equals(text, "hello", 5));
+	CHECK(text.decode_base64("abcde") == false);
+}
+
+static void test_hex(){
+	uint8_t src[200];
+	char expected[400];
+	for(uint32_t len = 0; len < sizeof(src); len++){
+		fill_random(src, len);
+		bool upper = (len % 2) != 0;
+		for(uint32_t i = 0; i < len; i++){
+			snprintf(expected + i * 2, 3, upper ? "%02X" : "%02x", src[i]);
+		}
+		TEST_STRING(encoded);
+		CHECK(encoded.append_hex(src, len, upper));
+		CHECK(equals(encoded, expected, len * 2));
+
+		TEST_STRING(decoded);
+		CHECK(decoded.decode_hex(ustring_view(expected, len * 2)));
+		CHECK(equals(decoded, (const char*)src, len));
+
+		if(len > 0){
+			expected[rand_byte() % (len * 2)] = 'g';
+			TEST_STRING(broken);
+			CHECK(broken.decode_hex(ustring_view(expected, len * 2)) == false);
+		}
+	}
+
+	const char *dump = "00000000  68 65 6c 6c 6f 0a                                 |hello.|\n";
+	TEST_STRING(text);
+	CHECK(text.append_hexdump("hello\n", 6));
+	CHECK(equals(text, dump, strlen(dump)));
+}
+
+static uint32_t ref_json_escape(char *dst, const char *src, uint32_t len){
+	uint32_t out = 0;
+	for(uint32_t i = 0; i < len; i++){
+		uint8_t ch = src[i];
+		const char *esc = NULL;
+		switch(ch){
+			case '"':	esc = "\\\"";	break;
+			case '\\':	esc = "\\\\";	break;
+			case '\b':	esc = "\\b";	break;
+			case '\f':	esc = "\\f";	break;
+			case '\n':	esc = "\\n";	break;
+			case '\r':	esc = "\\r";	break;
+			case '\t':	esc = "\\t";	break;
+			default:	break;
+		}
+		if(esc != NULL){
+			memcpy(dst + out, esc, 2);
+			out += 2;
+		}
+		else if(ch < 0x20){
+			out += snprintf(dst + out, 7, "\\u%04x", ch);
+		}
+		else{
+			dst[out++] = ch;
+		}
+	}
+	return out;
+}
+
+static void test_json_strings(){
+	char src[300];
+	char expected[2000];
+	for(uint32_t len = 0; len < sizeof(src); len++){
+		for(uint32_t i = 0; i < len; i++){
+			uint8_t kind = rand_byte() % 16;
+			src[i] = (kind == 0) ? '"' : (kind == 1) ? '\\' : (kind == 2) ? rand_byte() % 0x20 : (kind == 3) ? 0x80 | rand_byte() : 'a' + rand_byte() % 26;
+		}
+		uint32_t expected_len = ref_json_escape(expected, src, len);
+		TEST_STRING(escaped);
+		CHECK(escaped.append_json_escaped(ustring_view(src, len)));
+		CHECK(equals(escaped, expected, expected_len));
+
+		TEST_STRING(unescaped);//source is the local copy, strings of the same heap may move
+		CHECK(unescaped.append_json_unescaped(ustring_view(expected, expected_len)));
+		CHECK(equals(unescaped, src, len));
+	}
+
+	const char *utf8 = "caf\xC3\xA9 \xF0\x9F\x98\x80 /";
+	TEST_STRING(text);
+	CHECK(text.append_json_unescaped("caf\\u00e9 \\ud83d\\ude00 \\/"));
+	CHECK(equals(text, utf8, strlen(utf8)));
+	TEST_STRING(broken);
+	CHECK(broken.append_json_unescaped("\\ud83d") == false);
+	CHECK(broken.append_json_unescaped("\\q") == false);
+	CHECK(broken.append_json_unescaped("\\u12") == false);
+	CHECK(broken.size() == 0);
+}
+
+static void test_json_reader(){
+	TEST_STRING(json);
+	CHECK(json.assign("{\"name\": \"dev\\\"ice\", \"id\": 42, \"list\": [1, [2, 3], {\"a\": \"x,]}\"}, "
+			"\"long string which crosses several blocks of sixteen symbols\"], \"ok\": true, \"none\": null}"));
+	ustring_json_reader reader(json);
+	CHECK(reader.parse());
+	ustring_json_value root = reader.root();
+	CHECK(root.type() == USTRING_JSON_OBJECT);
+	CHECK(root.count() == 5);
+
+	TEST_STRING(name);
+	CHECK(root.get("name").has_escapes());
+	CHECK(root.get("name").get_string(name));
+	CHECK(equals(name, "dev\"ice", 7));
+	int64_t id = 0;
+	CHECK(root.get("id").get_int(&id) && (id == 42));
+	ustring_json_value list = root.get("list");
+	CHECK(list.count() == 4);
+	CHECK(list.at(1).count() == 2);
+	ustring_view inner = list.at(2).get("a").raw();
+	CHECK((inner.size() == 4) && (memcmp(inner.data(), "x,]}", 4) == 0));
+	bool ok = false;
+	CHECK(root.get("ok").get_bool(&ok) && ok);
+	CHECK(root.get("none").is_null());
+	CHECK(root.get("missing").valid() == false);
+
+	TEST_STRING(broken);
+	CHECK(broken.assign("{\"a\": [1, 2}"));
+	ustring_json_reader broken_reader(broken);
+	CHECK(broken_reader.parse() == false);
+	CHECK(broken_reader.root().valid() == false);
+
+	static const char *malformed[] = {"{\"a\" 1}", "{\"a\": 1 \"b\": 2}", "{\"a\":}", "{1: 2}", "[1 2]", "[1,]",
+			"{\"a\": 1,}", "[\"a\": 1]", "{\"a\": [1}", "[1] 2", "1, 2", "{\"a\"}"};
+	for(uint32_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++){
+		CHECK(broken.assign(malformed[i]));
+		CHECK(broken_reader.parse() == false);
+	}
+	static const char *wellformed[] = {"{}", "[]", " 42 ", "\"text\"", "{\"a\": {}, \"b\": [[], {}], \"c\": -1e5}"};
+	for(uint32_t i = 0; i < sizeof(wellformed) / sizeof(wellformed[0]); i++){
+		CHECK(broken.assign(wellformed[i]));
+		CHECK(broken_reader.parse());
+	}
+
+	/* Index of a long document grows in several steps during one pass */
+	TEST_STRING(big);
+	CHECK(big.append("["));
+	for(uint32_t i = 0; i < 1000; i++){
+		CHECK(big.append((i == 0) ? "{\"k\": [1, 2]}" : ", {\"k\": [1, 2]}"));
+	}
+	CHECK(big.append("]"));
+	ustring_json_reader big_reader(big);
+	CHECK(big_reader.parse());
+	CHECK(big_reader.index_size() == 2 + 1000 * 8 + 999 + 1);
+	CHECK(big_reader.root().count() == 1000);
+	CHECK(big_reader.root().at(999).get("k").count() == 2);
+}
+
+int main(){
+	test_init();
+	test_base64();
+	test_hex();
+	test_json_strings();
+	test_json_reader();
+#ifdef USTRING_USE_SSSE3
+	return test_result("test_codecs (SSSE3)");
+#elif defined(USTRING_USE_SSE2)
+	return test_result("test_codecs (SSE2)");
+#else
+	return test_result("test_codecs (scalar)");
+#endif
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "test.h"
+
+uint32_t test_failures = 0;
+
+#ifdef USE_SINGLE_HEAP_MEMORY
+uint8_t single_heap[SINGLE_HEAP_SIZE];
+#else
+heap_t test_heap;
+static uint8_t test_heap_array[TEST_HEAP_SIZE];
+#endif
+
+void test_init(){
+#ifndef USE_SINGLE_HEAP_MEMORY
+	heap_init(&test_heap, (void*)test_heap_array, TEST_HEAP_SIZE);
+#endif
+}
+
+int test_result(const char *name){
+	if(test_failures > 0){
+		printf("%s: %u checks failed\n", name, test_failures);
+		return 1;
+	}
+	printf("%s: ok\n", name);
+	return 0;
+}
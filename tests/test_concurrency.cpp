@@ -0,0 +1,534 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Checks of lock-free containers: capacity, ordering and error paths, and atomic_ustring with
+ * more readers than hazard slots */
+
+#include <string.h>
+#include <thread>
+#include <chrono>
+#include "test.h"
+#include "ustring_queue.h"
+#include "atomic_ustring.h"
+#include "ustring_ringlog.h"
+#include "ustring_budget.h"
+#include "ustring_intern.h"
+#include "ustring_executor.h"
+#include "ustring_parallel.h"
+#include "ustring_placement.h"
+
+#define TEST_QUEUE_DOMAIN				1
+
+#ifdef USTRING_USE_THREADS
+
+static bool equals(ustring &str, const char *expected){
+	return (str.size() == strlen(expected)) && (memcmp(str.data(), expected, str.size()) == 0);
+}
+
+template<typename Queue>
+static void test_queue(Queue &queue){
+	TEST_STRING(item);
+	CHECK(queue.pop(item) == false);//empty
+	CHECK(item.capacity() == 0);//idle consumer doesn't allocate
+	CHECK(queue.push("first", 5));
+	CHECK(queue.push("second", 6));
+	CHECK(queue.push("third", 5));
+	CHECK(queue.push("fourth", 6));
+	CHECK(queue.push("fifth", 5) == false);//full
+	CHECK(queue.push("0123456789abcdefX", 17) == false);//longer than slot
+
+	CHECK(queue.pop(item));
+	CHECK(equals(item, "first"));
+	CHECK(queue.pop(item));
+	CHECK(equals(item, "second"));
+	CHECK(queue.push("fifth", 5));//space of popped items is reused
+
+	ustring items[4];
+#ifndef USE_SINGLE_HEAP_MEMORY
+	for(uint32_t i = 0; i < 4; i++){
+		items[i].assign_mem_pointer(&test_heap);
+	}
+#endif
+	CHECK(queue.pop_batch(items, 4) == 3);
+	CHECK(equals(items[0], "third"));
+	CHECK(equals(items[1], "fourth"));
+	CHECK(equals(items[2], "fifth"));
+	CHECK(queue.pop(item) == false);
+
+	CHECK(queue.push_batch(items, 3) == 3);
+	CHECK(queue.pop(item));
+	CHECK(equals(item, "third"));
+
+	/* Item is not lost if consumer can't allocate memory for it */
+	TEST_STRING(limited);
+	limited.set_tag(TEST_QUEUE_DOMAIN);
+	CHECK(ustring_budget_set_quota(TEST_QUEUE_DOMAIN, 2));
+	CHECK(queue.pop(limited) == false);
+	CHECK(queue.pop_batch(&limited, 1) == 0);
+	CHECK(ustring_budget_set_quota(TEST_QUEUE_DOMAIN, 0));
+	CHECK(queue.pop(limited));
+	CHECK(equals(limited, "fourth"));
+	limited.set_tag(0);
+}
+
+#define TEST_MPMC_THREADS				4
+#define TEST_MPMC_ITEMS					2000
+
+/* Every item is delivered exactly once, and one consumer gets items of one producer in order */
+static void test_mpmc_threads(){
+	static ustring_mpmc_queue<16, 16> queue;
+	static std::atomic<uint8_t> received[TEST_MPMC_THREADS][TEST_MPMC_ITEMS];
+	static std::atomic<uint32_t> popped(0);
+	static std::atomic<uint32_t> order_errors(0);
+	std::thread producers[TEST_MPMC_THREADS];
+	std::thread consumers[TEST_MPMC_THREADS];
+	for(uint32_t t = 0; t < TEST_MPMC_THREADS; t++){
+		producers[t] = std::thread([t](){
+			char item[16];
+			for(uint32_t i = 0; i < TEST_MPMC_ITEMS; i++){
+				uint32_t len = snprintf(item, sizeof(item), "%u:%u", (unsigned)t, (unsigned)i);
+				while(queue.push(item, len) != true){
+					std::this_thread::yield();
+				}
+			}
+		});
+		consumers[t] = std::thread([](){
+#ifndef USE_SINGLE_HEAP_MEMORY
+			static thread_local heap_t heap;
+			static thread_local uint8_t heap_array[1024];
+			heap_init(&heap, (void*)heap_array, sizeof(heap_array));
+			ustring item(&heap);
+#else
+			ustring item;
+#endif
+			int32_t last[TEST_MPMC_THREADS];
+			for(uint32_t i = 0; i < TEST_MPMC_THREADS; i++){
+				last[i] = -1;
+			}
+			while(popped < TEST_MPMC_THREADS * TEST_MPMC_ITEMS){
+				if(queue.pop(item) != true){
+					std::this_thread::yield();
+					continue;
+				}
+				unsigned producer = 0, n = 0;
+				if((sscanf(item.c_str(), "%u:%u", &producer, &n) != 2) || (producer >= TEST_MPMC_THREADS) || (n >= TEST_MPMC_ITEMS)){
+					order_errors++;
+					popped++;
+					continue;
+				}
+				received[producer][n]++;
+				if((int32_t)n <= last[producer]){
+					order_errors++;
+				}
+				last[producer] = n;
+				popped++;
+			}
+		});
+	}
+	for(uint32_t t = 0; t < TEST_MPMC_THREADS; t++){
+		producers[t].join();
+		consumers[t].join();
+	}
+	CHECK(order_errors == 0);
+	uint32_t wrong = 0;
+	for(uint32_t t = 0; t < TEST_MPMC_THREADS; t++){
+		for(uint32_t i = 0; i < TEST_MPMC_ITEMS; i++){
+			wrong += (received[t][i] != 1);
+		}
+	}
+	CHECK(wrong == 0);
+	TEST_STRING(rest);
+	CHECK(queue.pop(rest) == false);
+}
+
+static void test_atomic_ustring(){
+	atomic_ustring cell;
+	atomic_ustring::snapshot empty = cell.load();
+	CHECK(empty.empty());
+	CHECK(strcmp(empty.c_str(), "") == 0);
+
+	CHECK(cell.store("first"));
+	atomic_ustring::snapshot first = cell.load();
+	CHECK(cell.store("second", 6));
+	atomic_ustring::snapshot second = cell.load();
+	CHECK(strcmp(first.c_str(), "first") == 0);//old snapshot stays valid
+	CHECK(strcmp(second.c_str(), "second") == 0);
+	CHECK(second.size() == 6);
+
+	atomic_ustring::snapshot copy = first;
+	first = second;
+	CHECK(strcmp(copy.c_str(), "first") == 0);
+	CHECK(strcmp(first.c_str(), "second") == 0);
+	CHECK(cell.try_load(copy));
+	CHECK(strcmp(copy.c_str(), "second") == 0);
+}
+
+/* Hazard slots are held only inside of load(), so more readers than slots don't block each other */
+static void test_atomic_ustring_readers(){
+	static const char *values[] = {"alpha", "beta", "gamma"};
+	atomic_ustring cell;
+	CHECK(cell.store(values[0]));
+	std::atomic<uint32_t> bad_reads(0);
+	std::thread readers[USTRING_HAZARD_SLOTS + 16];
+	for(uint32_t i = 0; i < sizeof(readers) / sizeof(readers[0]); i++){
+		readers[i] = std::thread([&](){
+			for(uint32_t j = 0; j < 200; j++){
+				atomic_ustring::snapshot snap = cell.load();
+				bool valid = false;
+				for(uint32_t k = 0; k < 3; k++){
+					valid |= (strcmp(snap.c_str(), values[k]) == 0);
+				}
+				bad_reads += !valid;
+			}
+		});
+	}
+	for(uint32_t i = 0; i < 3000; i++){
+		CHECK(cell.store(values[i % 3]));
+	}
+	for(uint32_t i = 0; i < sizeof(readers) / sizeof(readers[0]); i++){
+		readers[i].join();
+	}
+	CHECK(bad_reads == 0);
+}
+
+/* Concurrent growths in one domain can't exceed its quota together */
+static void test_budget(){
+	static const uint32_t quota = 50000;
+	CHECK(ustring_budget_set_quota(TEST_QUEUE_DOMAIN, quota));
+	uint32_t start_usage = ustring_budget_get_usage(TEST_QUEUE_DOMAIN);
+	std::atomic<uint32_t> charged(0);
+	std::thread threads[8];
+	for(uint32_t i = 0; i < 8; i++){
+		threads[i] = std::thread([&](){
+			for(uint32_t j = 0; j < 1000; j++){
+				if(ustring_budget_try_charge(TEST_QUEUE_DOMAIN, 0, 100)){
+					charged += 100;
+				}
+			}
+		});
+	}
+	for(uint32_t i = 0; i < 8; i++){
+		threads[i].join();
+	}
+	CHECK(ustring_budget_get_usage(TEST_QUEUE_DOMAIN) == start_usage + charged);
+	CHECK(ustring_budget_get_usage(TEST_QUEUE_DOMAIN) <= quota);
+	ustring_budget_charge(TEST_QUEUE_DOMAIN, charged, 0);
+	CHECK(ustring_budget_set_quota(TEST_QUEUE_DOMAIN, 0));
+}
+
+#ifndef USE_SINGLE_HEAP_MEMORY
+static void test_intern_without_init(){
+	static ustring_intern_table table;
+	CHECK(table.intern("name") == USTRING_INTERN_INVALID_ID);
+	CHECK(table.find("name") == USTRING_INTERN_INVALID_ID);
+	CHECK(table.size() == 0);
+}
+
+#define TEST_INTERN_KEYS				1000
+#define TEST_INTERN_SHARED_KEYS			200
+#define TEST_INTERN_THREADS				4
+
+static void test_intern(){
+	static heap_t shard_heaps[USTRING_INTERN_SHARDS];
+	static uint8_t shard_arrays[USTRING_INTERN_SHARDS][64 * 1024];
+	heap_t *heaps[USTRING_INTERN_SHARDS];
+	for(uint32_t i = 0; i < USTRING_INTERN_SHARDS; i++){
+		heap_init(&shard_heaps[i], (void*)shard_arrays[i], sizeof(shard_arrays[i]));
+		heaps[i] = &shard_heaps[i];
+	}
+	static ustring_intern_table table;
+	CHECK(table.init(heaps));
+
+	uint32_t alpha = table.intern("alpha");
+	CHECK(alpha != USTRING_INTERN_INVALID_ID);
+	CHECK(table.intern("alpha") == alpha);
+	CHECK(table.find("alpha") == alpha);
+	CHECK(table.find("beta") == USTRING_INTERN_INVALID_ID);
+
+	/* Enough keys to grow index of every shard several times */
+	static uint32_t ids[TEST_INTERN_KEYS];
+	bool used_shards[USTRING_INTERN_SHARDS] = {};
+	char name[32];
+	for(uint32_t i = 0; i < TEST_INTERN_KEYS; i++){
+		snprintf(name, sizeof(name), "key%u", (unsigned)i);
+		ids[i] = table.intern(name);
+		CHECK(ids[i] != USTRING_INTERN_INVALID_ID);
+		used_shards[(ids[i] >> 24) % USTRING_INTERN_SHARDS] = true;
+	}
+	CHECK(table.size() == TEST_INTERN_KEYS + 1);
+	for(uint32_t i = 0; i < USTRING_INTERN_SHARDS; i++){
+		CHECK(used_shards[i]);
+	}
+	TEST_STRING(out);
+	for(uint32_t i = 0; i < TEST_INTERN_KEYS; i++){
+		snprintf(name, sizeof(name), "key%u", (unsigned)i);
+		CHECK(table.intern(name) == ids[i]);
+		CHECK(table.find(name) == ids[i]);
+		CHECK(table.get(ids[i], out) && equals(out, name));
+	}
+	CHECK(table.get(USTRING_INTERN_INVALID_ID, out) == false);
+	CHECK(table.get(alpha + TEST_INTERN_KEYS, out) == false);
+
+	/* Threads intern the same keys concurrently and must get the same ids, every thread
+	 * reads results to a string in its own heap */
+	static uint32_t shared_ids[TEST_INTERN_THREADS][TEST_INTERN_SHARED_KEYS];
+	static heap_t thread_heaps[TEST_INTERN_THREADS];
+	static uint8_t thread_arrays[TEST_INTERN_THREADS][4096];
+	static bool thread_ok[TEST_INTERN_THREADS];
+	std::thread threads[TEST_INTERN_THREADS];
+	for(uint32_t t = 0; t < TEST_INTERN_THREADS; t++){
+		heap_init(&thread_heaps[t], (void*)thread_arrays[t], sizeof(thread_arrays[t]));
+		threads[t] = std::thread([t](){
+			ustring str(&thread_heaps[t]);
+			char key[32];
+			thread_ok[t] = true;
+			for(uint32_t i = 0; i < TEST_INTERN_SHARED_KEYS; i++){
+				uint32_t n = (i + t * 37) % TEST_INTERN_SHARED_KEYS;//different order in every thread
+				snprintf(key, sizeof(key), "shared%u", (unsigned)n);
+				shared_ids[t][n] = table.intern(key);
+				if((table.get(shared_ids[t][n], str) != true) || (str.compare(key) != 0)){
+					thread_ok[t] = false;
+				}
+				str.clear();
+			}
+		});
+	}
+	for(uint32_t t = 0; t < TEST_INTERN_THREADS; t++){
+		threads[t].join();
+		CHECK(thread_ok[t]);
+	}
+	for(uint32_t i = 0; i < TEST_INTERN_SHARED_KEYS; i++){
+		CHECK(shared_ids[0][i] != USTRING_INTERN_INVALID_ID);
+		for(uint32_t t = 1; t < TEST_INTERN_THREADS; t++){
+			CHECK(shared_ids[t][i] == shared_ids[0][i]);
+		}
+	}
+	CHECK(table.size() == TEST_INTERN_KEYS + 1 + TEST_INTERN_SHARED_KEYS);
+}
+#endif
+
+static void test_ringlog(){
+	static ustring_ringlog<1024> ring;
+	CHECK(ring.log("record %d;", 1));
+	CHECK(ring.write("raw;", 4));
+	char out[64];
+	uint32_t out_len = 0;
+	uint32_t num = ring.drain([&](const char *str, uint32_t len){
+		memcpy(out + out_len, str, len);
+		out_len += len;
+	});
+	CHECK(num == 2);
+	CHECK((out_len == 13) && (memcmp(out, "record 1;raw;", 13) == 0));
+
+	uint32_t written = 0;
+	while(ring.log("%0100d", 0)){
+		written++;
+	}
+	CHECK(written > 0);
+	CHECK(ring.dropped() == 1);
+	CHECK(ring.drain([](const char*, uint32_t){}) == written);
+	CHECK(ring.log("after wrap"));
+}
+
+#define TEST_EXECUTOR_TASKS				200
+#define TEST_STEAL_TASKS				16
+
+static std::atomic<uint32_t> executed(0);
+
+static void count_task(void *arg){
+	(void)arg;
+	std::this_thread::sleep_for(std::chrono::microseconds(50));
+	executed++;
+}
+
+typedef struct{
+	ustring_executor *executor;
+	int32_t owner;
+	std::atomic<uint32_t> done;
+	std::atomic<uint32_t> stolen;
+	bool all_done;
+} steal_ctx_t;
+
+static void stolen_task(void *arg){
+	steal_ctx_t *ctx = (steal_ctx_t*)arg;
+	ctx->stolen += (ustring_executor::current_worker() != ctx->owner);
+	ctx->done++;
+}
+
+/* Subtasks go to the deque of the worker that submits them, it is busy until they finish,
+ * so they can finish only if other workers steal them */
+static void owner_task(void *arg){
+	steal_ctx_t *ctx = (steal_ctx_t*)arg;
+	ctx->owner = ustring_executor::current_worker();
+	for(uint32_t i = 0; i < TEST_STEAL_TASKS; i++){
+		ctx->executor->submit(stolen_task, ctx);
+	}
+	auto start = std::chrono::steady_clock::now();
+	while((ctx->done < TEST_STEAL_TASKS) && (std::chrono::steady_clock::now() - start < std::chrono::seconds(10))){
+		std::this_thread::yield();
+	}
+	ctx->all_done = (ctx->done == TEST_STEAL_TASKS);
+}
+
+static void for_counter(uint32_t ind, void *ctx){
+	((std::atomic<uint32_t>*)ctx)[ind]++;
+}
+
+static void nested_for(uint32_t ind, void *ctx){
+	(void)ind;
+	static std::atomic<uint32_t> inner[64];
+	ustring_executor *executor = (ustring_executor*)ctx;
+	executor->parallel_for(64, for_counter, inner);
+	executed++;
+}
+
+/* Only worker is busy with this task, so parallel_for returns only if waiting thread runs
+ * the queued part of the loop itself */
+static void for_in_task(void *arg){
+	ustring_executor *executor = (ustring_executor*)arg;
+	executor->parallel_for(8, nested_for, executor);
+}
+
+static char to_upper(char ch){
+	return ((ch >= 'a') && (ch <= 'z')) ? ch - 'a' + 'A' : ch;
+}
+
+static void test_executor(){
+	ustring_executor executor;
+	CHECK(executor.start(0) == false);
+	CHECK(executor.start(3));
+	CHECK(executor.start(3) == false);//already started
+	CHECK(executor.workers_num() == 3);
+
+	executed = 0;
+	for(uint32_t i = 0; i < TEST_EXECUTOR_TASKS; i++){
+		executor.submit(count_task, NULL);
+	}
+	executor.wait();
+	CHECK(executed == TEST_EXECUTOR_TASKS);
+
+	static steal_ctx_t steal_ctx;
+	steal_ctx.executor = &executor;
+	steal_ctx.done = 0;
+	steal_ctx.stolen = 0;
+	executor.submit(owner_task, &steal_ctx);
+	executor.wait();
+	CHECK(steal_ctx.all_done);
+	CHECK(steal_ctx.stolen == TEST_STEAL_TASKS);
+
+	static std::atomic<uint32_t> calls[1000];
+	executor.parallel_for(1000, for_counter, calls);
+	for(uint32_t i = 0; i < 1000; i++){
+		CHECK(calls[i] == 1);
+	}
+
+	/* Parallel functions split string to chunks and run them on workers and calling thread */
+	TEST_STRING(str);
+	ustr_size_t len = USTRING_PARALLEL_MIN_CHUNK * 3 + 7;
+	CHECK(str.resize(len, 'a'));
+	str[USTRING_PARALLEL_MIN_CHUNK - 1] = 'X';
+	str[USTRING_PARALLEL_MIN_CHUNK] = 'Y';
+	CHECK(parallel_find(str, "XY", executor) == USTRING_PARALLEL_MIN_CHUNK - 1);
+	CHECK(parallel_find(str, "YX", executor) == ustring::npos);
+	CHECK(parallel_count(str, 'a', executor) == len - 2);
+	parallel_transform(str, to_upper, executor);
+	CHECK(parallel_count(str, 'A', executor) == len - 2);
+	parallel_to_lower(str, executor);
+	CHECK(str.count('a') == len - 2);
+
+	/* Shutdown runs all queued tasks before workers exit */
+	executed = 0;
+	for(uint32_t i = 0; i < TEST_EXECUTOR_TASKS; i++){
+		executor.submit(count_task, NULL);
+	}
+	executor.stop();
+	CHECK(executed == TEST_EXECUTOR_TASKS);
+	CHECK(executor.workers_num() == 0);
+	executor.submit(count_task, NULL);//stopped executor runs task in calling thread
+	CHECK(executed == TEST_EXECUTOR_TASKS + 1);
+
+	ustring_executor single;
+	CHECK(single.start(1));
+	executed = 0;
+	single.submit(for_in_task, &single);
+	single.wait();
+	CHECK(executed == 8);
+}
+
+#ifndef USE_SINGLE_HEAP_MEMORY
+static heap_t worker_heaps[2];
+static std::atomic<uint32_t> arrived(0);
+
+/* Both tasks wait for each other, so every worker gets one of them */
+static void heap_task(void *arg){
+	bool *ok = (bool*)arg;
+	arrived++;
+	auto start = std::chrono::steady_clock::now();
+	while((arrived < 2) && (std::chrono::steady_clock::now() - start < std::chrono::seconds(10))){
+		std::this_thread::yield();
+	}
+	int32_t worker = ustring_executor::current_worker();
+	ustring str;//placed to the heap of worker by policy
+	ok[worker] = (ustring_executor::current_heap() == &worker_heaps[worker]) && str.append("abc") &&
+			(str.get_mem_pointer() == &worker_heaps[worker]);
+}
+
+static void test_executor_heaps(){
+	static uint8_t worker_arrays[2][4096];
+	heap_t *heaps[2];
+	for(uint32_t i = 0; i < 2; i++){
+		heap_init(&worker_heaps[i], (void*)worker_arrays[i], sizeof(worker_arrays[i]));
+		heaps[i] = &worker_heaps[i];
+	}
+	ustring_set_placement_policy(ustring_worker_heap_policy);
+	ustring_executor executor;
+	CHECK(executor.start(2, heaps));
+	CHECK(ustring_executor::current_heap() == NULL);
+	CHECK(ustring_executor::current_worker() == -1);
+	static bool ok[2];
+	executor.submit(heap_task, ok);
+	executor.submit(heap_task, ok);
+	executor.stop();
+	for(uint32_t i = 0; i < 2; i++){
+		CHECK(ok[i]);
+	}
+	ustring_set_placement_policy(NULL);
+}
+#endif
+
+#endif // USTRING_USE_THREADS
+
+int main(){
+	test_init();
+#ifdef USTRING_USE_THREADS
+	ustring_spsc_queue<4, 16> spsc;
+	ustring_mpmc_queue<4, 16> mpmc;
+	test_queue(spsc);
+	test_queue(mpmc);
+	test_mpmc_threads();
+	test_atomic_ustring();
+	test_atomic_ustring_readers();
+	test_ringlog();
+	test_budget();
+	test_executor();
+#ifndef USE_SINGLE_HEAP_MEMORY
+	test_intern_without_init();
+	test_intern();
+	test_executor_heaps();
+#endif
+#endif
+	return test_result("test_concurrency");
+}
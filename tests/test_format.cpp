@@ -0,0 +1,131 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include "test.h"
+#include "ustring_format.h"
+#include "ustring_binlog.h"
+
+#define FORMAT_BUF_SIZE					1024
+
+static uint64_t rand_state = 1;
+
+static uint64_t rand_u64(){
+	rand_state ^= rand_state << 13;//xorshift64
+	rand_state ^= rand_state >> 7;
+	rand_state ^= rand_state << 17;
+	return rand_state;
+}
+
+/* Every result is compared with snprintf of C library */
+static void check_double(const char *fmt, double val){
+	char expected[FORMAT_BUF_SIZE];
+	char res[FORMAT_BUF_SIZE];
+	int expected_len = snprintf(expected, sizeof(expected), fmt, val);
+	ustr_size_t len = ustring_format(res, sizeof(res), fmt, val);
+	if((len != (ustr_size_t)expected_len) || (strcmp(res, expected) != 0)){
+		printf("%s: expected \"%s\", got \"%s\"\n", fmt, expected, res);
+		test_failures++;
+	}
+}
+
+static void check_uint(const char *fmt, unsigned int val){
+	char expected[FORMAT_BUF_SIZE];
+	char res[FORMAT_BUF_SIZE];
+	snprintf(expected, sizeof(expected), fmt, val);
+	ustring_format(res, sizeof(res), fmt, val);
+	if(strcmp(res, expected) != 0){
+		printf("%s: expected \"%s\", got \"%s\"\n", fmt, expected, res);
+		test_failures++;
+	}
+}
+
+static void test_floats(){
+	static const char *formats[] = {"%f", "%.0f", "%.3f", "%.25f", "%#.0f", "%+012.4f", "%-14.2F|", "%e", "%.0e",
+			"%#.0e", "%.12E", "%-16.3e|", "% 014e", "%g", "%.0g", "%.17g", "%#g", "%#.3g", "%G", "%+12.5g", "%.1f"};
+	static const double values[] = {0.0, -0.0, 0.5, 1.5, 2.5, 0.05, 0.125, 9.9999999, 99999.95, 1e-5, 1e-4, 123456789.0,
+			1.8e19, 3.4e38, 1e100, 1.7976931348623157e308, 4.9e-324, 2.2250738585072014e-308, 1.0 / 0.0, -1.0 / 0.0, 0.0 / 0.0};
+	for(uint32_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++){
+		for(uint32_t j = 0; j < sizeof(values) / sizeof(values[0]); j++){
+			check_double(formats[i], values[j]);
+			check_double(formats[i], -values[j]);
+		}
+		for(uint32_t j = 0; j < 2000; j++){
+			/* Random bit patterns cover all exponents, most of them don't fit to uint64_t */
+			uint64_t bits = rand_u64();
+			double val;
+			memcpy(&val, &bits, sizeof(val));
+			check_double(formats[i], val);
+			check_double(formats[i], (double)(int32_t)bits / 1000.0);
+		}
+	}
+}
+
+static void test_integers(){
+	static const char *formats[] = {"%#x", "%#X", "%#o", "%#08x", "%#.0o", "%#.0x", "%#10.4o"};
+	static const unsigned int values[] = {0, 1, 8, 255, 0xDEADBEEF};
+	for(uint32_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++){
+		for(uint32_t j = 0; j < sizeof(values) / sizeof(values[0]); j++){
+			check_uint(formats[i], values[j]);
+		}
+	}
+}
+
+static void test_args_limit(){
+	TEST_STRING(str);
+	CHECK(str.append_format("%d %s %.*f", 1, "two", 2, 3.0));
+	CHECK(strcmp(str.c_str(), "1 two 3.00") == 0);
+	/* Format must not print zeros instead of arguments that don't fit to the arguments array */
+	CHECK(str.append_format("%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d", 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17) == false);
+	CHECK(strcmp(str.c_str(), "1 two 3.00") == 0);
+	char buf[16];
+	ustring_fmt_arg_t args[1];
+	args[0].type = USTRING_ARG_INT;
+	args[0].val.i = 1;
+	CHECK(ustring_format_args(buf, sizeof(buf), "%d %d", args, 1) == ustring::npos);
+	CHECK(ustring_format_args(buf, sizeof(buf), "%d", args, 1) == 1);
+
+	/* Binary log record with less arguments than its format needs is broken */
+	static const char *log_formats[] = {"%d %d\n"};
+	TEST_STRING(log);
+	TEST_STRING(text);
+	CHECK(ustring_binlog_write(log, 0, 1));
+	uint8_t record[32];//decoding allocates in the heap of text, so source is copied out of it
+	CHECK(log.size() <= sizeof(record));
+	memcpy(record, log.data(), log.size());
+	CHECK(ustring_binlog_decode_all(record, log.size(), log_formats, 1, text) == 0);
+	CHECK(text.size() == 0);
+
+	/* Sum of string lengths must not wrap around before space is reserved */
+	ustring_fmt_arg_t big_args[USTRING_FORMAT_MAX_ARGS];
+	for(uint32_t i = 0; i < USTRING_FORMAT_MAX_ARGS; i++){
+		big_args[i].type = USTRING_ARG_STR;
+		big_args[i].len = ustring::npos - 1;
+		big_args[i].val.s = "x";//never read
+	}
+	ustr_size_t log_size = log.size();
+	CHECK(ustring_binlog_write_args(log, 1, big_args, USTRING_FORMAT_MAX_ARGS) == false);
+	CHECK(log.size() == log_size);
+}
+
+int main(){
+	test_init();
+	test_floats();
+	test_integers();
+	test_args_limit();
+	return test_result("test_format");
+}
@@ -0,0 +1,572 @@
+/*
+ * Copyright 2021 Alexey Vasilenko
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <string.h>
+#include "test.h"
+#include "ustring_parallel.h"
+#include "ustring_pin.h"
+#include "ustring_placement.h"
+#include "ustring_tag.h"
+#include "ustring_budget.h"
+#include "ustring_peak.h"
+#include "ustring_pressure.h"
+#include "ustring_idle.h"
+#include "ustring_batch.h"
+#ifdef USTRING_USE_THREADS
+#include <thread>
+#endif
+
+static char to_upper(char ch){
+	return ((ch >= 'a') && (ch <= 'z')) ? ch - 'a' + 'A' : ch;
+}
+
+static void test_append(){
+	TEST_STRING(str);
+	CHECK(str.append("hello"));
+	CHECK(str.append(' '));
+	CHECK(str.append("world", 5));
+	CHECK(str.size() == 11);
+	CHECK(strcmp(str.c_str(), "hello world") == 0);
+
+	char *buf = str.append_buffer(3);
+	CHECK(buf != NULL);
+	memcpy(buf, "!!!", 3);
+	CHECK(strcmp(str.c_str(), "hello world!!!") == 0);
+	CHECK(str.pop_back());
+	CHECK(strcmp(str.c_str(), "hello world!!") == 0);
+
+	/* Source is read after memory is reserved, so a string can be appended to itself */
+	TEST_STRING(twice);
+	CHECK(twice.assign("abc"));
+	CHECK(twice.append(twice));
+	CHECK(twice.append(twice));
+	CHECK(strcmp(twice.c_str(), "abcabcabcabc") == 0);
+	ustring copy(twice);
+	CHECK(copy.compare("abcabcabcabc") == 0);
+	CHECK(copy.assign(str));
+	CHECK(copy.compare("hello world!!") == 0);
+	CHECK(copy.assign(copy));
+	CHECK(copy.compare("hello world!!") == 0);
+}
+
+static void test_terminator(){
+	/* Every mutator writes the terminator, also into a new block after reallocation */
+	TEST_STRING(str);
+	CHECK(str.assign("hello"));
+	CHECK(strcmp(str.c_str(), "hello") == 0);
+	CHECK(str.reserve(100));
+	CHECK(strlen(str.c_str()) == 5);
+	for(uint32_t i = 0; i < 200; i++){
+		CHECK(str.push_back('a' + i % 26));
+		CHECK(strlen(str.data()) == str.size());
+	}
+	CHECK(str.resize(3));
+	CHECK(strcmp(str.data(), "hel") == 0);
+	CHECK(str.shrink_to_fit());
+	CHECK(strcmp(str.data(), "hel") == 0);
+
+	/* data() is only a reader, it may be called concurrently, c_str() restores the terminator */
+	const ustring &view = str;
+	str.data()[3] = 'x';
+	CHECK(view.data()[3] == 'x');
+	CHECK(strcmp(str.c_str(), "hel") == 0);
+	str.clear();
+	CHECK(str.c_str()[0] == '\0');
+}
+
+static void test_limits(){
+	/* Size never wraps around, only small size types can be filled up to the limit in tests */
+	TEST_STRING(str);
+	CHECK(str.append_buffer(ustring::npos) == NULL);
+	CHECK(str.resize(ustring::npos) == false);
+	CHECK(str.reserve(ustring::npos) == false);
+	CHECK(str.size() == 0);
+	if(str.max_size() > TEST_HEAP_SIZE / 4){
+		return;
+	}
+	CHECK(str.resize(str.max_size(), 'a'));
+	CHECK(str.push_back('a') == false);
+	CHECK(str.append("a", 1) == false);
+	CHECK(str.append_buffer(1) == NULL);
+	CHECK(str.size() == str.max_size());
+	CHECK(strlen(str.c_str()) == str.max_size());
+}
+
+static void test_pin(){
+	TEST_STRING(str);
+	CHECK(str.assign("frame"));
+	{
+		ustring_pin pin(str);
+		CHECK(pin.pinned() == false);//heap doesn't allow pinning
+		CHECK(ustring_heap_is_pinned(str.get_mem_pointer()) == false);
+	}
+
+	TEST_STRING(tail);
+	CHECK(tail.assign(" and more data that doesn't fit"));
+	CHECK(ustring_heap_allow_pinning(str.get_mem_pointer()));
+	{
+		ustring_pin pin(str);
+		CHECK(pin.pinned());
+		CHECK(ustring_heap_disallow_pinning(str.get_mem_pointer()) == false);
+		CHECK(str.reserve(1000) == false);//allocation and free calls would move blocks
+		CHECK(str.shrink_to_fit() == false);
+		CHECK(pin.data() == str.data());
+
+		/* Failures are visible and the old value is kept */
+		CHECK(str.append(tail) == false);
+		CHECK((str += tail) == false);
+		CHECK(str.assign(tail) == false);
+		CHECK(strcmp(str.c_str(), "frame") == 0);
+		CHECK(str.assign("ok"));//fits to allocated memory
+		CHECK(str.assign("frame"));
+		ustring copy(tail);//copy can't report failure, see ustring_pin.h
+		CHECK(copy.size() == 0);
+		CHECK(pin.data() == str.data());
+	}
+	CHECK(str.reserve(1000));
+	CHECK(str.shrink_to_fit());
+	CHECK(ustring_heap_disallow_pinning(str.get_mem_pointer()));
+}
+
+#ifndef USE_SINGLE_HEAP_MEMORY
+static heap_t policy_heap;
+
+static heap_t* test_policy(ustr_size_t size, uint8_t tag, heap_t *current){
+	(void)size;
+	(void)tag;
+	(void)current;
+	return &policy_heap;
+}
+
+static void test_placement(){
+	static uint8_t policy_heap_array[64 * 1024];
+	heap_init(&policy_heap, (void*)policy_heap_array, sizeof(policy_heap_array));
+	ustring_set_placement_policy(test_policy);
+
+	TEST_STRING(explicit_heap);//explicit heap is not overridden by policy
+	CHECK(explicit_heap.append("abc"));
+	CHECK(explicit_heap.get_mem_pointer() == &test_heap);
+	ustring copy(explicit_heap);
+	CHECK(copy.get_mem_pointer() == &test_heap);
+
+	ustring placed;
+	CHECK(placed.append("abc"));
+	CHECK(placed.get_mem_pointer() == &policy_heap);
+	ustring sum = explicit_heap + "def";
+	CHECK(sum.get_mem_pointer() == &policy_heap);
+
+	/* Only strings placed by policy spill, explicit heap is kept even if it's full */
+	static heap_t small_heap, spill_heap;
+	static uint8_t small_heap_array[256], spill_heap_array[4096];
+	heap_init(&small_heap, (void*)small_heap_array, sizeof(small_heap_array));
+	heap_init(&spill_heap, (void*)spill_heap_array, sizeof(spill_heap_array));
+	const ustring_size_class_t classes[] = {{1024, &small_heap}};
+	ustring_set_size_classes(classes, 1);
+	ustring_set_placement_policy(ustring_size_class_policy);
+	CHECK(ustring_set_spill_heap(&small_heap, &spill_heap));
+	{
+		ustring spilled;
+		CHECK(spilled.reserve(1000));
+		CHECK(spilled.get_mem_pointer() == &spill_heap);
+		ustring fits;
+		CHECK(fits.reserve(100));
+		CHECK(fits.get_mem_pointer() == &small_heap);
+		ustring explicit_small(&small_heap);
+		CHECK(explicit_small.reserve(1000) == false);
+		CHECK(explicit_small.get_mem_pointer() == &small_heap);
+	}
+	CHECK(ustring_set_spill_heap(&small_heap, NULL));
+
+	/* Fill level policy selects heap with the most free memory */
+	heap_t * const fill_heaps[] = {&small_heap, &spill_heap};
+	ustring_set_fill_heaps(fill_heaps, 2);
+	ustring_set_placement_policy(ustring_fill_level_policy);
+	{
+		ustring first;
+		CHECK(first.reserve(3900));
+		CHECK(first.get_mem_pointer() == &spill_heap);
+		ustring second;
+		CHECK(second.reserve(100));
+		CHECK(second.get_mem_pointer() == &small_heap);//spill heap has less free memory now
+	}
+	ustring_set_fill_heaps(NULL, 0);
+	ustring_set_size_classes(NULL, 0);
+	ustring_set_placement_policy(NULL);
+}
+
+static heap_t pressure_heap;
+static ustring *pressure_extra = NULL;
+static bool pressure_extra_subscribed = false;
+static uint32_t pressure_calls = 0;
+
+/* Subscribing takes the registry lock, so it would deadlock if callbacks were called under the lock */
+static void pressure_cb(heap_t *heap){
+	if(heap == &pressure_heap){
+		pressure_calls++;
+		pressure_extra_subscribed = pressure_extra->subscribe_memory_pressure();
+	}
+}
+
+static void test_pressure(){
+	static uint8_t pressure_heap_array[1024];
+	heap_init(&pressure_heap, (void*)pressure_heap_array, sizeof(pressure_heap_array));
+	uint32_t subscribers = ustring_pressure_subscribers_num();
+	ustring extra(&pressure_heap);
+	pressure_extra = &extra;
+	CHECK(ustring_pressure_add_callback(pressure_cb));
+	{
+		ustring cached(&pressure_heap);
+		CHECK(cached.assign("cached value"));
+		CHECK(cached.reserve(600));
+		CHECK(cached.subscribe_memory_pressure());
+		CHECK(cached.subscribe_memory_pressure());//subscribed once
+		TEST_STRING(other_heap);
+		CHECK(other_heap.reserve(600));
+		CHECK(other_heap.subscribe_memory_pressure());
+		CHECK(ustring_pressure_subscribers_num() == subscribers + 2);
+
+		ustring big(&pressure_heap);
+		CHECK(big.reserve(600));//fits only after spare memory of cached is released
+		CHECK(cached.capacity() == cached.size() + 1);
+		CHECK(strcmp(cached.c_str(), "cached value") == 0);
+		CHECK(other_heap.capacity() > 600);//strings of other heaps are not shrunk
+		CHECK(pressure_calls == 1);
+		CHECK(pressure_extra_subscribed);
+		CHECK(ustring_pressure_subscribers_num() == subscribers + 3);
+
+		/* Idle reservation doesn't take memory of subscribed strings */
+		ustring spare(&pressure_heap);
+		CHECK(spare.reserve(300));
+		CHECK(spare.subscribe_memory_pressure());
+		ustring idle(&pressure_heap);
+		CHECK(idle.set_idle_headroom(200));
+		uint32_t idle_num = ustring_idle_strings_num();
+		for(uint32_t i = 0; i < idle_num; i++){
+			CHECK(ustring_idle_step(NULL, 0) == 0);
+		}
+		CHECK(idle.capacity() == 0);
+		CHECK(spare.capacity() > 300);
+		CHECK(pressure_calls == 1);
+	}
+	CHECK(ustring_pressure_subscribers_num() == subscribers + 1);//destroyed strings are unsubscribed
+	CHECK(ustring_idle_strings_num() == 0);
+	extra.unsubscribe_memory_pressure();
+	CHECK(ustring_pressure_subscribers_num() == subscribers);
+	ustring_pressure_remove_callback(pressure_cb);
+}
+#endif
+
+static uint32_t idle_clock = 0;
+
+static uint32_t idle_now(){
+	return idle_clock++;
+}
+
+static void test_idle(){
+	uint32_t registered = ustring_idle_strings_num();
+	{
+		TEST_STRING(first);
+		TEST_STRING(second);
+		TEST_STRING(third);
+		CHECK(first.append("abc"));
+		CHECK(first.set_idle_headroom(100));
+		CHECK(second.set_idle_headroom(200));
+		CHECK(third.set_idle_headroom(300));
+		CHECK(first.set_idle_headroom(150));//headroom is updated, string is registered once
+		CHECK(ustring_idle_strings_num() == registered + 3);
+
+		/* Without clock one string is processed per step, next step continues with the next string */
+		CHECK(registered == 0);
+		for(uint32_t i = 0; i < 3; i++){
+			CHECK(ustring_idle_step(NULL, 0) == 1);
+			uint32_t with_headroom = (first.capacity() > 3 + 150) + (second.capacity() > 200) + (third.capacity() > 300);
+			CHECK(with_headroom == i + 1);
+		}
+		CHECK(ustring_idle_step(idle_now, 1000) == 0);//all have headroom already
+
+		/* Headroom is restored after appends */
+		char *buf = second.append_buffer(200);
+		CHECK(buf != NULL);
+		memset(buf, 'a', 200);
+		CHECK(ustring_idle_step(idle_now, 1000) == 1);
+		CHECK(second.capacity() > 200 + 200);
+		CHECK(second.size() == 200);
+
+		CHECK(third.set_idle_headroom(0));
+		CHECK(ustring_idle_strings_num() == registered + 2);
+		CHECK(third.set_idle_headroom(0));//not registered, nothing to do
+		CHECK(ustring_idle_strings_num() == registered + 2);
+	}
+	CHECK(ustring_idle_strings_num() == registered);//destroyed strings are unregistered
+}
+
+#define TEST_BATCH_STRINGS				10//more than prefetch distance
+
+static void test_batch(){
+	static const char *values[TEST_BATCH_STRINGS] = {"alpha", "beta", "", "gamma", "delta", "beta", "epsilon", "zeta", "eta", "theta"};
+	ustring strings[TEST_BATCH_STRINGS];
+	uint64_t expected_size = 0;
+	for(uint32_t i = 0; i < TEST_BATCH_STRINGS; i++){
+#ifndef USE_SINGLE_HEAP_MEMORY
+		strings[i].assign_mem_pointer(&test_heap);
+#endif
+		if(values[i][0] != '\0'){//empty string stays unallocated
+			CHECK(strings[i].assign(values[i]));
+		}
+		expected_size += strlen(values[i]);
+	}
+
+	uint32_t hashes[TEST_BATCH_STRINGS];
+	int32_t results[TEST_BATCH_STRINGS];
+	ustr_size_t positions[TEST_BATCH_STRINGS];
+	hash_all(strings, TEST_BATCH_STRINGS, hashes);
+	compare_all_to(strings, TEST_BATCH_STRINGS, "beta", results);
+	find_in_all(strings, TEST_BATCH_STRINGS, "ta", positions);
+	for(uint32_t i = 0; i < TEST_BATCH_STRINGS; i++){
+		CHECK(hashes[i] == ustring_hash(values[i], strlen(values[i])));
+		CHECK(results[i] == strings[i].compare("beta"));
+		const char *pos = strstr(values[i], "ta");
+		CHECK(positions[i] == ((pos != NULL) ? (ustr_size_t)(pos - values[i]) : ustring::npos));
+	}
+	CHECK(hashes[1] == hashes[5]);
+	CHECK((results[1] == 0) && (results[5] == 0) && (results[0] != 0));
+	CHECK(total_size(strings, TEST_BATCH_STRINGS) == expected_size);
+	CHECK(total_size(strings, 0) == 0);
+	CHECK(sizeof(total_size(strings, 0)) == sizeof(uint64_t));//sum of many strings can exceed uint32_t
+}
+
+static void test_batch_memory(){
+	ustring strings[TEST_BATCH_STRINGS];
+	uint32_t capacities[TEST_BATCH_STRINGS];
+	for(uint32_t i = 0; i < TEST_BATCH_STRINGS; i++){
+#ifndef USE_SINGLE_HEAP_MEMORY
+		strings[i].assign_mem_pointer(&test_heap);
+#endif
+		if(i != 3){//one string has no memory
+			CHECK(strings[i].resize(10 + i * 10, 'a'));
+		}
+		capacities[i] = strings[i].capacity();
+	}
+
+	/* Recycled strings keep memory, so the next batch fits without allocations */
+	recycle_all(strings, TEST_BATCH_STRINGS);
+	for(uint32_t i = 0; i < TEST_BATCH_STRINGS; i++){
+		CHECK(strings[i].size() == 0);
+		CHECK(strings[i].capacity() == capacities[i]);
+		CHECK(strcmp(strings[i].c_str(), "") == 0);
+	}
+	CHECK(strings[5].append("next batch"));
+	CHECK(strings[5].capacity() == capacities[5]);
+
+	uint32_t expected = 0;
+	for(uint32_t i = 0; i < TEST_BATCH_STRINGS; i++){
+		expected += capacities[i];
+	}
+	CHECK(release_all(strings, TEST_BATCH_STRINGS) == expected);
+	for(uint32_t i = 0; i < TEST_BATCH_STRINGS; i++){
+		CHECK(strings[i].size() == 0);
+		CHECK(strings[i].capacity() == 0);
+	}
+	CHECK(release_all(strings, TEST_BATCH_STRINGS) == 0);//nothing left to release
+
+#ifndef USE_SINGLE_HEAP_MEMORY
+	uvector<ustring> column(&test_heap);
+#else
+	uvector<ustring> column;
+#endif
+	for(uint32_t i = 0; i < 3; i++){
+		CHECK(column.push_back(strings[i]));
+		CHECK(column[i].resize(20, 'b'));
+	}
+	uint32_t column_capacity = column[0].capacity() + column[1].capacity() + column[2].capacity();
+	recycle_all(column);
+	CHECK(total_size(column) == 0);
+	CHECK(release_all(column) == column_capacity);
+}
+
+static void test_tags(){
+	/* Tags are kept outside of the object, table keeps them correct while strings come and go */
+	CHECK(sizeof(ustring) == sizeof(uvector<char>));
+	{
+		TEST_STRING(tagged);
+		CHECK(tagged.set_tag(3));
+		CHECK(tagged.append("abc"));
+		CHECK(tagged.get_tag() == 3);
+		CHECK(ustring_budget_get_usage(3) == tagged.capacity());
+		ustring copy(tagged);
+		CHECK(copy.get_tag() == 3);
+		CHECK(ustring_tagged_strings_num() == 2);
+
+		ustring strs[40];
+		for(uint32_t i = 0; i < 40; i++){
+			CHECK(strs[i].set_tag(i % 7 + 1));
+		}
+		for(uint32_t i = 0; i < 40; i += 2){
+			CHECK(strs[i].set_tag(0));
+		}
+		for(uint32_t i = 0; i < 40; i++){
+			CHECK(strs[i].get_tag() == ((i % 2 == 0) ? 0 : i % 7 + 1));
+		}
+		CHECK(ustring_tagged_strings_num() == 22);
+		CHECK(copy.set_tag(0));
+		CHECK(ustring_budget_get_usage(3) == tagged.capacity());
+	}
+	CHECK(ustring_tagged_strings_num() == 0);
+	CHECK(ustring_budget_get_usage(3) == 0);
+}
+
+static void test_search(){
+	TEST_STRING(str);
+	CHECK(str.assign("abcabcabc"));
+	CHECK(str.find("cab") == 2);
+	CHECK(str.find("cab", 3) == 5);
+	CHECK(str.find("xyz") == ustring::npos);
+	CHECK(str.find('c', 3) == 5);
+	CHECK(str.count('a') == 3);
+	str.transform(to_upper);
+	CHECK(strcmp(str.c_str(), "ABCABCABC") == 0);
+	str.to_lower();
+	CHECK(strcmp(str.c_str(), "abcabcabc") == 0);
+}
+
+#ifdef USTRING_TRACK_PEAK
+#define TEST_PEAK_THREADS				2
+
+static void peak_worker(){
+#ifndef USE_SINGLE_HEAP_MEMORY
+	static thread_local heap_t heap;
+	static thread_local uint8_t heap_array[4096];
+	heap_init(&heap, (void*)heap_array, sizeof(heap_array));
+#endif
+	for(uint32_t i = 0; i < 1000; i++){
+#ifndef USE_SINGLE_HEAP_MEMORY
+		ustring str(&heap);
+#else
+		ustring str;
+#endif
+		str.reserve(16);
+		str.reserve(256);
+	}
+}
+
+/* Stats are global, so checks are made relative to usage before the test */
+static void test_peak(){
+	ustring_peak_stats_t before, stats;
+	ustring_peak_get_stats(&before);
+	{
+		TEST_STRING(str);
+		CHECK(str.reserve(100));
+		uint32_t first = str.capacity();
+		ustring_peak_get_stats(&stats);
+		CHECK(stats.live_bytes == before.live_bytes + first);
+		CHECK(stats.live_blocks == before.live_blocks + 1);
+
+		CHECK(str.reserve(1000));
+		uint32_t second = str.capacity();
+		ustring_peak_get_stats(&stats);
+		CHECK(stats.live_bytes == before.live_bytes + second);
+		CHECK(stats.live_blocks == before.live_blocks + 1);
+		CHECK(stats.reallocations == before.reallocations + 1);
+		CHECK(stats.peak_bytes >= before.live_bytes + first + second);//both blocks exist while data is moved
+		CHECK(stats.peak_blocks >= before.live_blocks + 2);
+
+		ustring_peak_reset();
+		ustring_peak_get_stats(&stats);
+		CHECK(stats.peak_bytes == stats.live_bytes);
+		CHECK(stats.peak_blocks == stats.live_blocks);
+		CHECK(stats.reallocations == 0);
+		uint64_t expected = stats.peak_bytes + (uint64_t)stats.peak_blocks * USTRING_PEAK_BLOCK_OVERHEAD;
+		CHECK(ustring_peak_recommended_heap_size(0) == expected);
+		CHECK(ustring_peak_recommended_heap_size(50) == expected + expected / 2);
+		CHECK(ustring_peak_recommended_heap_size(200) == expected * 3);
+		CHECK(ustring_peak_recommended_heap_size(UINT32_MAX) == UINT32_MAX);//limited, not wrapped
+	}
+	ustring_peak_get_stats(&stats);
+	CHECK(stats.live_bytes == before.live_bytes);
+	CHECK(stats.live_blocks == before.live_blocks);
+
+#ifdef USTRING_USE_THREADS
+	/* Reports are taken while other threads change stats */
+	std::thread workers[TEST_PEAK_THREADS];
+	for(uint32_t i = 0; i < TEST_PEAK_THREADS; i++){
+		workers[i] = std::thread(peak_worker);
+	}
+	for(uint32_t i = 0; i < 1000; i++){
+		ustring_peak_get_stats(&stats);
+		CHECK(stats.peak_bytes >= stats.live_bytes);
+		CHECK(ustring_peak_recommended_heap_size(25) >= stats.live_bytes);
+	}
+	for(uint32_t i = 0; i < TEST_PEAK_THREADS; i++){
+		workers[i].join();
+	}
+	ustring_peak_get_stats(&stats);
+	CHECK(stats.live_bytes == before.live_bytes);
+	CHECK(stats.live_blocks == before.live_blocks);
+#endif
+}
+#endif
+
+/* Several parallel chunks don't fit to 16 bit sizes */
+#if defined(USTRING_USE_THREADS) && !defined(TEST_SMALL_SIZES)
+static void test_parallel(){
+	/* Several chunks, so matches can cross chunk boundaries */
+	TEST_STRING(str);
+	ustr_size_t len = USTRING_PARALLEL_MIN_CHUNK * 3 + 7;
+	CHECK(str.resize(len, 'a'));
+	str[USTRING_PARALLEL_MIN_CHUNK - 2] = 'X';
+	str[USTRING_PARALLEL_MIN_CHUNK - 1] = 'Y';
+	str[USTRING_PARALLEL_MIN_CHUNK] = 'Z';
+	str[len - 1] = 'Q';
+
+	CHECK(parallel_find(str, "XYZ", 4) == str.find("XYZ"));
+	CHECK(parallel_find(str, "XYZ", 4) == USTRING_PARALLEL_MIN_CHUNK - 2);
+	CHECK(parallel_find(str, "aQ", 4) == len - 2);
+	CHECK(parallel_find(str, "QQ", 4) == ustring::npos);
+	CHECK(parallel_count(str, 'a', 4) == str.count('a'));
+	parallel_transform(str, to_upper, 4);
+	CHECK(parallel_count(str, 'A', 4) == len - 4);
+	parallel_to_lower(str, 4);
+	CHECK(str.count('a') == len - 4);
+}
+#endif
+
+int main(){
+	test_init();
+	test_append();
+	test_terminator();
+	test_limits();
+	test_pin();
+#ifndef USE_SINGLE_HEAP_MEMORY
+	test_placement();
+	test_pressure();
+#endif
+	test_idle();
+	test_batch();
+	test_batch_memory();
+	test_tags();
+	test_search();
+#ifdef USTRING_TRACK_PEAK
+	test_peak();
+#endif
+#if defined(USTRING_USE_THREADS) && !defined(TEST_SMALL_SIZES)
+	test_parallel();
+#endif
+#ifdef USTRING_TRACK_PEAK
+	return test_result("test_ustring (peak tracking)");
+#else
+	return test_result((sizeof(ustr_size_t) == 2) ? "test_ustring (16 bit sizes)" : "test_ustring");
+#endif
+}